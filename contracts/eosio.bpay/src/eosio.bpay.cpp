@@ -28,29 +28,11 @@ void bpay::on_transfer( const name from, const name to, const asset quantity, co
     check( quantity.symbol == system_symbol, "only core token allowed" );
 
     rewards_table _rewards( get_self(), get_self().value );
-    eosiosystem::producers_table _producers( "eosio"_n, "eosio"_n.value );
 
-    eosiosystem::global_state_singleton _global("eosio"_n, "eosio"_n.value);
-    check( _global.exists(), "global state does not exist");
-    uint16_t producer_count = _global.get().last_producer_schedule_size;
-
-    // get producer with the most votes
-    // using `by_votes` secondary index
-    auto idx = _producers.get_index<"prototalvote"_n>();
-    auto prod = idx.begin();
+    uint16_t producer_count = eosiosystem::read_global_states("eosio"_n).global.last_producer_schedule_size;
 
     // get top n producers by vote, excluding inactive
-    std::vector<name> top_producers;
-    while (true) {
-        if (prod == idx.end()) break;
-        if (prod->is_active == false) continue;
-        
-        top_producers.push_back(prod->owner);
-
-        if (top_producers.size() == producer_count) break;
-        
-        prod++;
-    }
+    std::vector<name> top_producers = eosiosystem::get_top_active_producers( producer_count, "eosio"_n );
 
     asset reward = quantity / top_producers.size();
 
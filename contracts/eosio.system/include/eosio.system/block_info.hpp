@@ -2,25 +2,69 @@
 
 #include <eosio/multi_index.hpp>
 #include <eosio/name.hpp>
+#include <eosio/singleton.hpp>
 #include <eosio/time.hpp>
 
+#include <eosio.system/db_profiler.hpp>
+
 #include <limits>
 #include <optional>
 
 namespace eosiosystem::block_info {
 
-static constexpr uint32_t rolling_window_size = 10;
+static constexpr uint32_t rolling_window_size     = 10;
+static constexpr uint32_t max_rolling_window_size = 1200;
+static constexpr uint8_t  ring_version            = 1;
+
+/**
+ * Position of the blockinfo ring, stored in the single row of the blockinforng table.
+ *
+ * The version starts at 1 so that it can be told apart from the records of the original one-row-per-block layout of
+ * the blockinfo table, which have a version of 0.
+ */
+struct [[eosio::table("blockinforng"), eosio::contract("eosio.system")]] block_info_ring
+{
+   uint8_t  version             = ring_version;
+   uint32_t window_size         = rolling_window_size;
+   uint32_t latest_block_height = 0;
+
+   uint32_t slot(uint32_t block_height) const { return block_height % window_size; }
+
+   EOSLIB_SERIALIZE(block_info_ring, (version)(window_size)(latest_block_height))
+};
+
+using block_info_ring_singleton = singleton<"blockinforng"_n, block_info_ring>;
 
 /**
  * The blockinfo table holds a rolling window of records containing information for recent blocks.
  *
- * Each record stores the height and timestamp of the correspond block.
- * A record is added for a new block through the onblock action.
- * The onblock action also erases up to two old records at a time in an attempt to keep the table consisting of only
- * records for blocks going back a particular block height difference backward from the most recent block.
- * Currently that block height difference is hardcoded to 10.
+ * The table is a ring buffer of `window_size` rows: the information for block height `h` is kept in the row with the
+ * primary key `h % window_size`, which is overwritten in place once the block falls out of the rolling window. The
+ * onblock action therefore writes one record and the position of the ring per block instead of adding and pruning
+ * rows. The size of the window defaults to `rolling_window_size` and can be changed through the setblockinfo action.
+ *
+ * Readers built for the original layout, keyed by block height, find a version of 1 in the records and report
+ * `unsupported_version` instead of misreading the ring.
+ */
+struct [[eosio::table("blockinfo"), eosio::contract("eosio.system")]] block_info_slot
+{
+   uint8_t                version      = ring_version;
+   uint32_t               slot         = 0;
+   uint32_t               block_height = 0;
+   eosio::block_timestamp block_timestamp;
+
+   uint64_t primary_key() const { return slot; }
+
+   EOSLIB_SERIALIZE(block_info_slot, (version)(slot)(block_height)(block_timestamp))
+};
+
+using block_info_table = multi_index<"blockinfo"_n, block_info_slot>;
+
+/**
+ * Layout of the rows of the blockinfo table before it was turned into a ring, one row per block keyed by block height.
+ * Only used to erase the remaining rows when the ring is first created.
  */
-struct [[eosio::table, eosio::contract("eosio.system")]] block_info_record
+struct block_info_record
 {
    uint8_t           version = 0;
    uint32_t          block_height;
@@ -31,7 +75,7 @@ struct [[eosio::table, eosio::contract("eosio.system")]] block_info_record
    EOSLIB_SERIALIZE(block_info_record, (version)(block_height)(block_timestamp))
 };
 
-using block_info_table = eosio::multi_index<"blockinfo"_n, block_info_record>;
+using legacy_block_info_table = multi_index<"blockinfo"_n, block_info_record>;
 
 struct block_batch_info
 {
@@ -74,12 +118,15 @@ struct latest_block_batch_info_result
  * Note that the range spanning from the start to end block of the latest block batch may be less than batch_size
  * because latest block batch may be incomplete.
  * Also, it is possible for the record capturing info for the starting block to not exist in the blockinfo table. This
- * can either be due to the records being erased as they fall out of the rolling window or, in rare cases, due to gaps
+ * can either be due to the records being overwritten as they fall out of the rolling window or, in rare cases, due to gaps
  * in block info records due to failures of the onblock action. In such a case, this function will be unable to return a
  * `block_batch_info` and will instead be forced to return the `insufficient_data` error code.
  * Furthermore, if `batch_start_height_offset` is greater than the height of the latest block for which
  * information is recorded in the blockinfo table, there will be no latest block batch identified for the function to
  * return information about and so it will again be forced to return the `insufficient_data` error code instead.
+ *
+ * Both records are located by slot arithmetic on the position of the ring, so the cost of this function is three table
+ * lookups regardless of `batch_size`.
  */
 latest_block_batch_info_result get_latest_block_batch_info(uint32_t    batch_start_height_offset,
                                                            uint32_t    batch_size,
@@ -92,26 +139,36 @@ latest_block_batch_info_result get_latest_block_batch_info(uint32_t    batch_sta
       return result;
    }
 
-   block_info_table t(system_account_name, 0);
+   block_info_ring_singleton ring_singleton(system_account_name, 0);
 
    // Find information on latest block recorded in the blockinfo table.
 
-   if (t.cbegin() == t.cend()) {
+   if (!ring_singleton.exists()) {
       // The blockinfo table is empty.
       result.error_code = latest_block_batch_info_result::insufficient_data;
       return result;
    }
 
-   auto latest_block_info_itr = --t.cend();
+   const block_info_ring ring = ring_singleton.get();
 
-   if (latest_block_info_itr->version != 0) {
+   if (ring.version != ring_version) {
       // Compiled code for this function within the calling contract has not been updated to support new version of
       // the blockinfo table.
       result.error_code = latest_block_batch_info_result::unsupported_version;
       return result;
    }
 
-   uint32_t latest_block_batch_end_height = latest_block_info_itr->block_height;
+   block_info_table t(system_account_name, 0);
+
+   auto latest_block_info = t.find(ring.slot(ring.latest_block_height));
+   if (ring.latest_block_height == 0 || latest_block_info == t.cend() ||
+       latest_block_info->block_height != ring.latest_block_height) {
+      // No block has been recorded in the ring yet.
+      result.error_code = latest_block_batch_info_result::insufficient_data;
+      return result;
+   }
+
+   uint32_t latest_block_batch_end_height = ring.latest_block_height;
 
    if (latest_block_batch_end_height < batch_start_height_offset) {
       // Caller asking for a block batch that has not even begun to be recorded yet.
@@ -126,48 +183,29 @@ latest_block_batch_info_result get_latest_block_batch_info(uint32_t    batch_sta
 
    // Note: 1 <= (latest_block_batch_end_height - latest_block_batch_start_height + 1) <= batch_size
 
-   if (latest_block_batch_start_height == latest_block_batch_end_height) {
-      // When batch_size == 1, this function effectively simplifies to just returning the info of the latest recorded
-      // block. In that case, the start block and the end block of the batch are the same and there is no need for
-      // another lookup. So shortcut the rest of the process and return a successful result immediately.
-      result.result.emplace(block_batch_info{
-         .batch_start_height          = latest_block_batch_start_height,
-         .batch_start_timestamp       = latest_block_info_itr->block_timestamp,
-         .batch_current_end_height    = latest_block_batch_end_height,
-         .batch_current_end_timestamp = latest_block_info_itr->block_timestamp,
-      });
-      return result;
-   }
-
    // Find information on start block of the latest block batch recorded in the blockinfo table.
+   // When batch_size == 1, this is the record of the latest recorded block.
 
-   auto start_block_info_itr = t.find(latest_block_batch_start_height);
-   if (start_block_info_itr == t.cend() || start_block_info_itr->block_height != latest_block_batch_start_height) {
+   auto start_block_info = t.find(ring.slot(latest_block_batch_start_height));
+   if (start_block_info == t.cend() || start_block_info->block_height != latest_block_batch_start_height) {
       // Record for information on start block of the latest block batch could not be found in blockinfo table.
       // This is either because of:
       //    * a gap in recording info due to a failed onblock action;
       //    * a requested start block that was processed by onblock prior to deployment of the system contract code
       //    introducing the blockinfo table;
-      //    * or, most likely, because the record for the requested start block was pruned from the blockinfo table as
-      //    it fell out of the rolling window.
+      //    * or, most likely, because the record of the requested start block was overwritten as the block fell out
+      //    of the rolling window.
       result.error_code = latest_block_batch_info_result::insufficient_data;
       return result;
    }
 
-   if (start_block_info_itr->version != 0) {
-      // Compiled code for this function within the calling contract has not been updated to support new version of
-      // the blockinfo table.
-      result.error_code = latest_block_batch_info_result::unsupported_version;
-      return result;
-   }
-
    // Successfully return block_batch_info for the found latest block batch in its current state.
 
    result.result.emplace(block_batch_info{
       .batch_start_height          = latest_block_batch_start_height,
-      .batch_start_timestamp       = start_block_info_itr->block_timestamp,
+      .batch_start_timestamp       = start_block_info->block_timestamp.to_time_point(),
       .batch_current_end_height    = latest_block_batch_end_height,
-      .batch_current_end_timestamp = latest_block_info_itr->block_timestamp,
+      .batch_current_end_timestamp = latest_block_info->block_timestamp.to_time_point(),
    });
    return result;
 }
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <eosio/datastream.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <eosio/print.hpp>
+#include <eosio/singleton.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace eosiosystem {
+
+#ifdef SYSTEM_PROFILE_DB_ACCESS
+
+   /**
+    * Database access profiling, enabled by building with `-DSYSTEM_PROFILE_DB_ACCESS=ON`.
+    *
+    * The `multi_index` and `singleton` templates of this namespace count every table operation performed through
+    * them, per table, together with the number of bytes serialized to and deserialized from the database. The
+    * counters are printed to the action console when the system contract finishes executing the action.
+    *
+    * Counting happens at the table interface, so each counter maps to the database intrinsic the operation starts
+    * with (`db_find_i64`/`db_lowerbound_i64` for `find`, `db_get_i64` for `get`, and so on); advancing iterators and
+    * updating the secondary keys of a modified row are not counted. Profiling builds must not be deployed.
+    */
+   namespace profiling {
+
+      enum class db_op : uint8_t {
+         find,
+         get,
+         store,
+         update,
+         remove,
+         idx_find,
+         idx_store,
+         idx_remove,
+         count
+      };
+
+      struct table_counters {
+         eosio::name table;
+         uint32_t    ops[static_cast<size_t>(db_op::count)] = {};
+         uint64_t    bytes_read    = 0;
+         uint64_t    bytes_written = 0;
+      };
+
+      inline std::vector<table_counters>& counters() {
+         static std::vector<table_counters> c;
+         return c;
+      }
+
+      inline table_counters& counters_of( eosio::name table ) {
+         auto& c = counters();
+         for( auto& t : c ) {
+            if( t.table == table ) return t;
+         }
+         c.push_back( table_counters{ table } );
+         return c.back();
+      }
+
+      inline void count( eosio::name table, db_op op, uint32_t n = 1 ) {
+         counters_of( table ).ops[static_cast<size_t>(op)] += n;
+      }
+
+      inline void count_read( eosio::name table, uint64_t bytes ) {
+         auto& t = counters_of( table );
+         ++t.ops[static_cast<size_t>(db_op::get)];
+         t.bytes_read += bytes;
+      }
+
+      inline void count_write( eosio::name table, db_op op, uint64_t bytes ) {
+         auto& t = counters_of( table );
+         ++t.ops[static_cast<size_t>(op)];
+         t.bytes_written += bytes;
+      }
+
+      inline void report() {
+         for( const auto& t : counters() ) {
+            auto op = [&]( db_op o ) { return t.ops[static_cast<size_t>(o)]; };
+            eosio::print( "db profile ", t.table,
+                          ": find=", op(db_op::find), " get=", op(db_op::get), " store=", op(db_op::store),
+                          " update=", op(db_op::update), " remove=", op(db_op::remove),
+                          " idx_find=", op(db_op::idx_find), " idx_store=", op(db_op::idx_store),
+                          " idx_remove=", op(db_op::idx_remove),
+                          " bytes_read=", t.bytes_read, " bytes_written=", t.bytes_written, "\n" );
+         }
+      }
+
+      template<eosio::name::raw TableName, typename T, typename... Indices>
+      class multi_index : public eosio::multi_index<TableName, T, Indices...> {
+         using base = eosio::multi_index<TableName, T, Indices...>;
+         static constexpr eosio::name table{ TableName };
+
+         template<typename Index>
+         class counted_index : public Index {
+         public:
+            explicit counted_index( const Index& idx ) : Index( idx ) {}
+
+            template<typename Key>
+            auto find( const Key& key )const        { return read( Index::find( key ) ); }
+            template<typename Key>
+            auto lower_bound( const Key& key )const { return read( Index::lower_bound( key ) ); }
+            template<typename Key>
+            auto upper_bound( const Key& key )const { return read( Index::upper_bound( key ) ); }
+            auto begin()const                       { return read( Index::begin() ); }
+            auto cbegin()const                      { return read( Index::cbegin() ); }
+
+            template<typename Key, typename... Msg>
+            auto require_find( const Key& key, Msg... msg )const { return read( Index::require_find( key, msg... ) ); }
+
+            template<typename Key, typename... Msg>
+            const T& get( const Key& key, Msg... msg )const {
+               count( table, db_op::idx_find );
+               const T& obj = Index::get( key, msg... );
+               count_read( table, eosio::pack_size( obj ) );
+               return obj;
+            }
+
+            template<typename Lambda>
+            void modify( typename Index::const_iterator itr, eosio::name payer, Lambda&& updater ) {
+               Index::modify( itr, payer, [&]( auto& obj ) {
+                  updater( obj );
+                  count_write( table, db_op::update, eosio::pack_size( obj ) );
+               });
+            }
+
+            auto erase( typename Index::const_iterator itr ) {
+               count( table, db_op::remove );
+               count( table, db_op::idx_remove, sizeof...(Indices) );
+               return Index::erase( itr );
+            }
+
+         private:
+            template<typename Iterator>
+            Iterator read( Iterator itr )const {
+               count( table, db_op::idx_find );
+               if( itr != Index::cend() ) count_read( table, eosio::pack_size( *itr ) );
+               return itr;
+            }
+         };
+
+      public:
+         using typename base::const_iterator;
+         using base::base;
+
+         const_iterator find( uint64_t primary )const        { return read( base::find( primary ) ); }
+         const_iterator lower_bound( uint64_t primary )const { return read( base::lower_bound( primary ) ); }
+         const_iterator upper_bound( uint64_t primary )const { return read( base::upper_bound( primary ) ); }
+         const_iterator begin()const                         { return read( base::begin() ); }
+         const_iterator cbegin()const                        { return read( base::cbegin() ); }
+
+         template<typename... Msg>
+         const_iterator require_find( uint64_t primary, Msg... msg )const { return read( base::require_find( primary, msg... ) ); }
+
+         template<typename... Msg>
+         const T& get( uint64_t primary, Msg... msg )const {
+            count( table, db_op::find );
+            const T& obj = base::get( primary, msg... );
+            count_read( table, eosio::pack_size( obj ) );
+            return obj;
+         }
+
+         template<typename Lambda>
+         const_iterator emplace( eosio::name payer, Lambda&& constructor ) {
+            auto itr = base::emplace( payer, std::forward<Lambda>(constructor) );
+            count_write( table, db_op::store, eosio::pack_size( *itr ) );
+            count( table, db_op::idx_store, sizeof...(Indices) );
+            return itr;
+         }
+
+         template<typename Lambda>
+         void modify( const_iterator itr, eosio::name payer, Lambda&& updater ) {
+            modify( *itr, payer, std::forward<Lambda>(updater) );
+         }
+
+         template<typename Lambda>
+         void modify( const T& obj, eosio::name payer, Lambda&& updater ) {
+            base::modify( obj, payer, [&]( auto& o ) {
+               updater( o );
+               count_write( table, db_op::update, eosio::pack_size( o ) );
+            });
+         }
+
+         const_iterator erase( const_iterator itr ) {
+            count_erase();
+            return base::erase( itr );
+         }
+
+         void erase( const T& obj ) {
+            count_erase();
+            base::erase( obj );
+         }
+
+         template<eosio::name::raw IndexName>
+         auto get_index() {
+            using index_type = decltype( base::template get_index<IndexName>() );
+            return counted_index<index_type>( base::template get_index<IndexName>() );
+         }
+
+         template<eosio::name::raw IndexName>
+         auto get_index()const {
+            using index_type = decltype( base::template get_index<IndexName>() );
+            return counted_index<index_type>( base::template get_index<IndexName>() );
+         }
+
+      private:
+         const_iterator read( const_iterator itr )const {
+            count( table, db_op::find );
+            if( itr != base::cend() ) count_read( table, eosio::pack_size( *itr ) );
+            return itr;
+         }
+
+         void count_erase() {
+            count( table, db_op::remove );
+            count( table, db_op::idx_remove, sizeof...(Indices) );
+         }
+      };
+
+      template<eosio::name::raw SingletonName, typename T>
+      class singleton : public eosio::singleton<SingletonName, T> {
+         using base = eosio::singleton<SingletonName, T>;
+         static constexpr eosio::name table{ SingletonName };
+
+      public:
+         using base::base;
+
+         bool exists() {
+            count( table, db_op::find );
+            return base::exists();
+         }
+
+         T get() {
+            count( table, db_op::find );
+            return read( base::get() );
+         }
+
+         T get_or_default( const T& def = T() ) {
+            count( table, db_op::find );
+            return read( base::get_or_default( def ) );
+         }
+
+         T get_or_create( eosio::name bill_to_account, const T& def = T() ) {
+            count( table, db_op::find );
+            return read( base::get_or_create( bill_to_account, def ) );
+         }
+
+         void set( const T& value, eosio::name bill_to_account ) {
+            count( table, db_op::find );
+            count_write( table, db_op::update, eosio::pack_size( value ) );
+            base::set( value, bill_to_account );
+         }
+
+         void remove() {
+            count( table, db_op::find );
+            count( table, db_op::remove );
+            base::remove();
+         }
+
+      private:
+         static T read( T value ) {
+            count_read( table, eosio::pack_size( value ) );
+            return value;
+         }
+      };
+
+   } // namespace profiling
+
+   using profiling::multi_index;
+   using profiling::singleton;
+
+#else
+
+   using eosio::multi_index;
+   using eosio::singleton;
+
+#endif
+
+} // namespace eosiosystem
@@ -9,9 +9,11 @@
 #include <eosio/time.hpp>
 #include <eosio/instant_finality.hpp>
 
+#include <eosio.system/db_profiler.hpp>
 #include <eosio.system/exchange_state.hpp>
 #include <eosio.system/native.hpp>
 
+#include <algorithm>
 #include <deque>
 #include <optional>
 #include <string>
@@ -136,11 +138,11 @@ namespace eosiosystem {
 
       uint64_t primary_key()const { return bidder.value; }
    };
-   typedef eosio::multi_index< "namebids"_n, name_bid,
-                               indexed_by<"highbid"_n, const_mem_fun<name_bid, uint64_t, &name_bid::by_high_bid>  >
-                             > name_bid_table;
+   typedef multi_index< "namebids"_n, name_bid,
+                        indexed_by<"highbid"_n, const_mem_fun<name_bid, uint64_t, &name_bid::by_high_bid>  >
+                      > name_bid_table;
 
-   typedef eosio::multi_index< "bidrefunds"_n, bid_refund > bid_refund_table;
+   typedef multi_index< "bidrefunds"_n, bid_refund > bid_refund_table;
 
    // Defines new global state parameters.
    struct [[eosio::table("global"), eosio::contract("eosio.system")]] eosio_global_state : eosio::blockchain_parameters {
@@ -224,7 +226,7 @@ namespace eosiosystem {
       eosio::public_key                                        producer_key; /// a packed public key object
       bool                                                     is_active = true;
       std::string                                              url;
-      uint32_t                                                 unpaid_blocks = 0;
+      uint32_t                                                 unpaid_blocks = 0; /// see `producer_blocks`
       time_point                                               last_claim_time;
       uint16_t                                                 location = 0;
       eosio::binary_extension<eosio::block_signing_authority>  producer_authority; // added in version 1.9.0
@@ -298,6 +300,20 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( producer_info2, (owner)(votepay_share)(last_votepay_share_update) )
    };
 
+   // Defines `producer_blocks` structure to be stored in the `prodblocks` table, holding the number of blocks produced
+   // since the last claimrewards. It is kept apart from `producer_info` so that the onblock transaction only rewrites
+   // this small row instead of the whole `producer_info` row and its `prototalvote` index entry.
+   // The `unpaid_blocks` field of `producer_info` only holds blocks produced before this table was introduced;
+   // claimrewards pays and resets both.
+   struct [[eosio::table("prodblocks"), eosio::contract("eosio.system")]] producer_blocks {
+      name            owner;
+      uint32_t        unpaid_blocks = 0;
+
+      uint64_t primary_key()const { return owner.value; }
+
+      EOSLIB_SERIALIZE( producer_blocks, (owner)(unpaid_blocks) )
+   };
+
    // finalizer_key_info stores information about a finalizer key.
    struct [[eosio::table("finkeys"), eosio::contract("eosio.system")]] finalizer_key_info {
       uint64_t          id;                   // automatically generated ID for the key in the table
@@ -316,7 +332,7 @@ namespace eosiosystem {
 
       bool is_active(uint64_t finalizer_active_key_id) const { return id == finalizer_active_key_id ; }
    };
-   typedef eosio::multi_index<
+   typedef multi_index<
       "finkeys"_n, finalizer_key_info,
       indexed_by<"byfinname"_n, const_mem_fun<finalizer_key_info, uint64_t, &finalizer_key_info::by_fin_name>>,
       indexed_by<"byfinkey"_n, const_mem_fun<finalizer_key_info, checksum256, &finalizer_key_info::by_fin_key>>
@@ -331,7 +347,7 @@ namespace eosiosystem {
 
       uint64_t primary_key() const { return finalizer_name.value; }
    };
-   typedef eosio::multi_index< "finalizers"_n, finalizer_info > finalizers_table;
+   typedef multi_index< "finalizers"_n, finalizer_info > finalizers_table;
 
    // finalizer_auth_info stores a finalizer's key id and its finalizer authority
    struct finalizer_auth_info {
@@ -363,7 +379,23 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( last_prop_finalizers_info, (last_proposed_finalizers) )
    };
 
-   typedef eosio::multi_index< "lastpropfins"_n, last_prop_finalizers_info >  last_prop_fins_table;
+   typedef multi_index< "lastpropfins"_n, last_prop_finalizers_info >  last_prop_fins_table;
+
+   // A single entry storing the digest of the last producer schedule accepted by the host, so that
+   // update_elected_producers does not propose the same schedule again.
+   struct [[eosio::table("lastpropsch"), eosio::contract("eosio.system")]] last_prop_producers_info {
+      checksum256 schedule_hash; // sha256 of the packed vector of producer authorities, sorted by producer name
+      // Producers visited in rank order while building the last schedule. As long as the ranking starts with the same
+      // producers and none of them re-registered or changed finalizer keys, the schedule is not built again, which
+      // avoids reading the producer rows and their authorities. Empty when the next update must build the schedule.
+      binary_extension<std::vector<name>> visited_producers;
+
+      uint64_t primary_key()const { return 0; }
+
+      EOSLIB_SERIALIZE( last_prop_producers_info, (schedule_hash)(visited_producers) )
+   };
+
+   typedef multi_index< "lastpropsch"_n, last_prop_producers_info >  last_prop_producers_table;
 
    // A single entry storing next available finalizer key_id to make sure
    // key_id in finalizers_table will never be reused.
@@ -374,7 +406,7 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( fin_key_id_generator_info, (next_finalizer_key_id) )
    };
 
-   typedef eosio::multi_index< "finkeyidgen"_n, fin_key_id_generator_info >  fin_key_id_gen_table;
+   typedef multi_index< "finkeyidgen"_n, fin_key_id_generator_info >  fin_key_id_gen_table;
 
    // A single entry storing a vector of names, each of which is a pattern that new account names
    // are checked against (when the `newaccount` is called), in order to reject the creation
@@ -387,7 +419,7 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( account_name_blacklist, (disallowed) )
    };
 
-   typedef eosio::multi_index< "acctdenylist"_n, account_name_blacklist >  account_name_blacklist_table;
+   typedef multi_index< "acctdenylist"_n, account_name_blacklist >  account_name_blacklist_table;
 
    // Store hash values allowing account blacklist names to be added to `account_name_blacklist_table`
    struct [[eosio::table("acctdenyhash"), eosio::contract("eosio.system")]] deny_hash {
@@ -398,7 +430,7 @@ namespace eosiosystem {
       checksum256  by_hash()     const { return hash; }
    };
 
-   typedef eosio::multi_index<
+   typedef multi_index<
       "denyhashlist"_n, deny_hash,
       indexed_by<"byhash"_n, const_mem_fun<deny_hash, checksum256, &deny_hash::by_hash>>> deny_hash_table;
 
@@ -424,15 +456,17 @@ namespace eosiosystem {
 
 
       uint32_t            flags1 = 0;
-      uint32_t            reserved2 = 0;
-      eosio::asset        reserved3;
+      uint32_t            reserved2 = 0; /// id of the `votesets` row holding the producers, if flags1 has `interned_producers` set
+      eosio::asset        reserved3; /// total stake delegated by this voter, once flags1 has `delegated_stake` set
 
       uint64_t primary_key()const { return owner.value; }
 
       enum class flags1_fields : uint32_t {
          ram_managed = 1,
          net_managed = 2,
-         cpu_managed = 4
+         cpu_managed = 4,
+         delegated_stake = 8,
+         interned_producers = 16
       };
 
       // explicit serialization macro is not necessary, used here only to improve compilation time
@@ -440,24 +474,315 @@ namespace eosiosystem {
    };
 
 
-   typedef eosio::multi_index< "voters"_n, voter_info >  voters_table;
+   typedef multi_index< "voters"_n, voter_info >  voters_table;
+
+   // A set of producers voted for by one or more voters. Once enabled by `cfgvotesets`, voters store the id of the
+   // set instead of their own copy of the producers, see `voter_info::flags1_fields::interned_producers`. Rows are
+   // billed to the system contract, since they are shared by voters.
+   struct [[eosio::table("votesets"), eosio::contract("eosio.system")]] vote_set {
+      uint64_t            id;
+      checksum256         hash;          // sha256 of the packed producers
+      std::vector<name>   producers;     // sorted
+      uint64_t            refcount = 0;  // number of voters referencing the set, removed when it drops to 0
+
+      uint64_t primary_key()const { return id; }
+      checksum256 by_hash()const { return hash; }
+
+      EOSLIB_SERIALIZE( vote_set, (id)(hash)(producers)(refcount) )
+   };
+
+   typedef multi_index< "votesets"_n, vote_set,
+                        indexed_by<"byhash"_n, const_mem_fun<vote_set, checksum256, &vote_set::by_hash>>
+                      > vote_sets_table;
+
+   // Whether new votes are stored in the `votesets` table
+   struct [[eosio::table("votesetcfg"), eosio::contract("eosio.system")]] vote_set_config {
+      bool enabled = false;
 
+      EOSLIB_SERIALIZE( vote_set_config, (enabled) )
+   };
+
+   typedef singleton< "votesetcfg"_n, vote_set_config >  vote_set_config_singleton;
+
+   struct producer_vote_delta {
+      name     producer;
+      double   delta = 0;
+
+      EOSLIB_SERIALIZE( producer_vote_delta, (producer)(delta) )
+   };
+
+   // A single entry accumulating the vote changes of the producers until the next producer schedule update, when
+   // they are applied to the `producers` table. Only present while deferred vote tallying is enabled by `cfgvotetally`.
+   struct [[eosio::table("votetally"), eosio::contract("eosio.system")]] vote_tally {
+      std::vector<producer_vote_delta> deltas; // sorted by producer
+
+      uint64_t primary_key()const { return 0; }
+
+      EOSLIB_SERIALIZE( vote_tally, (deltas) )
+   };
 
-   typedef eosio::multi_index< "producers"_n, producer_info,
-                               indexed_by<"prototalvote"_n, const_mem_fun<producer_info, double, &producer_info::by_votes>  >
-                             > producers_table;
+   typedef multi_index< "votetally"_n, vote_tally >  vote_tally_table;
 
-   typedef eosio::multi_index< "producers2"_n, producer_info2 > producers_table2;
 
-   typedef eosio::multi_index< "schedules"_n, schedules_info > schedules_table;
+   typedef multi_index< "producers"_n, producer_info,
+                        indexed_by<"prototalvote"_n, const_mem_fun<producer_info, double, &producer_info::by_votes>  >
+                      > producers_table;
 
-   typedef eosio::singleton< "global"_n, eosio_global_state >   global_state_singleton;
+   typedef multi_index< "producers2"_n, producer_info2 > producers_table2;
 
-   typedef eosio::singleton< "global2"_n, eosio_global_state2 > global_state2_singleton;
+   typedef multi_index< "prodblocks"_n, producer_blocks > producer_blocks_table;
 
-   typedef eosio::singleton< "global3"_n, eosio_global_state3 > global_state3_singleton;
+   static constexpr uint32_t producer_ranking_size = 50;
 
-   typedef eosio::singleton< "global4"_n, eosio_global_state4 > global_state4_singleton;
+   // Defines `ranked_producer`, an entry of the `prodranking` table
+   struct ranked_producer {
+      name            owner;
+      double          total_votes = 0;
+      bool            is_active = true;
+
+      // Only producers that are active or have votes are ranked
+      bool eligible()const { return is_active || total_votes > 0; }
+
+      // Producers are ranked by descending votes, active producers first on equal votes, then by name
+      bool ranks_before( const ranked_producer& other )const {
+         if( total_votes != other.total_votes ) return total_votes > other.total_votes;
+         if( is_active != other.is_active ) return is_active;
+         return owner < other.owner;
+      }
+
+      EOSLIB_SERIALIZE( ranked_producer, (owner)(total_votes)(is_active) )
+   };
+
+   // A single entry holding the `producer_ranking_size` eligible producers, active or not, with the most votes in
+   // ranking order, or all of them if there are fewer. It is kept up to date as votes and registrations change, so
+   // that the producer schedule update, switchtosvnn, getpeerkeys, eosio.bpay and off-chain indexers read one row
+   // instead of walking the `prototalvote` index.
+   struct [[eosio::table("prodranking"), eosio::contract("eosio.system")]] producer_ranking_info {
+      std::vector<ranked_producer> producers;
+
+      uint64_t primary_key()const { return 0; }
+
+      EOSLIB_SERIALIZE( producer_ranking_info, (producers) )
+   };
+
+   typedef multi_index< "prodranking"_n, producer_ranking_info > producer_ranking_table;
+
+   // Computes the content of the `prodranking` table from the `prototalvote` index of `producers`
+   inline std::vector<ranked_producer> build_producer_ranking( const producers_table& producers ) {
+      std::vector<ranked_producer> ranking;
+      auto idx = producers.get_index<"prototalvote"_n>();
+
+      // active producers with votes are indexed first in descending order of votes, followed by producers without
+      // votes and then by inactive producers with votes in ascending order of votes
+      size_t active_count = 0;
+      for( auto it = idx.cbegin(); it != idx.cend() && it->by_votes() <= 0 && active_count < producer_ranking_size; ++it ) {
+         if( it->active() ) {
+            ranking.push_back( ranked_producer{ it->owner, it->total_votes, true } );
+            ++active_count;
+         }
+      }
+      for( auto it = idx.cend(); it != idx.cbegin() && ranking.size() < active_count + producer_ranking_size; ) {
+         --it;
+         if( it->by_votes() <= 0 ) break;
+         ranking.push_back( ranked_producer{ it->owner, it->total_votes, false } );
+      }
+
+      std::sort( ranking.begin(), ranking.end(), []( const ranked_producer& a, const ranked_producer& b ) {
+         return a.ranks_before( b );
+      });
+      if( ranking.size() > producer_ranking_size ) ranking.resize( producer_ranking_size );
+      return ranking;
+   }
+
+   // Reads the producer ranking of the system contract deployed to `system_account`, computing it from the
+   // `producers` table if the `prodranking` row has not been created yet
+   inline std::vector<ranked_producer> read_producer_ranking( name system_account = "eosio"_n ) {
+      producer_ranking_table ranking( system_account, system_account.value );
+      auto itr = ranking.find( 0 );
+      if( itr != ranking.end() )
+         return itr->producers;
+      return build_producer_ranking( producers_table( system_account, system_account.value ) );
+   }
+
+   // Returns up to `count` active producers of the system contract deployed to `system_account` in descending order
+   // of votes. The `prototalvote` index is only walked if the ranking holds fewer than `count` active producers.
+   inline std::vector<name> get_top_active_producers( uint32_t count, name system_account = "eosio"_n ) {
+      std::vector<name> top;
+      const auto ranking = read_producer_ranking( system_account );
+      for( const auto& p : ranking ) {
+         if( top.size() == count ) break;
+         if( p.is_active ) top.push_back( p.owner );
+      }
+      if( top.size() == count || ranking.size() < producer_ranking_size )
+         return top;
+
+      top.clear();
+      producers_table producers( system_account, system_account.value );
+      auto idx = producers.get_index<"prototalvote"_n>();
+      for( auto it = idx.cbegin(); it != idx.cend() && top.size() < count; ++it ) {
+         if( it->active() ) top.push_back( it->owner );
+      }
+      return top;
+   }
+
+   typedef multi_index< "schedules"_n, schedules_info > schedules_table;
+
+   typedef singleton< "global"_n, eosio_global_state >   global_state_singleton;
+
+   typedef singleton< "global2"_n, eosio_global_state2 > global_state2_singleton;
+
+   typedef singleton< "global3"_n, eosio_global_state3 > global_state3_singleton;
+
+   typedef singleton< "global4"_n, eosio_global_state4 > global_state4_singleton;
+
+   // Consolidated global state, replacing the `global` through `global4` rows once `mergeglobals` has run so that
+   // actions read and write a single row.
+   struct [[eosio::table("globalstate"), eosio::contract("eosio.system")]] eosio_global_states {
+      uint8_t               version = 0;
+      bool                  mirror_legacy = true; ///< keep writing changes to the `global` through `global4` rows
+      eosio_global_state    global;
+      eosio_global_state2   global2;
+      eosio_global_state3   global3;
+      eosio_global_state4   global4;
+
+      EOSLIB_SERIALIZE( eosio_global_states, (version)(mirror_legacy)(global)(global2)(global3)(global4) )
+   };
+
+   typedef singleton< "globalstate"_n, eosio_global_states > global_states_singleton;
+
+   // Compares two global state structs by their serialized form, which is what would be written to the row
+   template<typename T>
+   bool same_global_state( const T& a, const T& b ) {
+      return eosio::pack( a ) == eosio::pack( b );
+   }
+
+   /**
+    * The consolidated global state row, read on first access.
+    *
+    * `save()` writes the row back if it differs from what was read.
+    */
+   class global_states_store {
+   public:
+      explicit global_states_store( name code ) : _singleton( code, code.value ) {}
+
+      // Returns the consolidated row, or nullptr if the global state has not been merged yet
+      eosio_global_states* get() {
+         if( !_read ) {
+            _read = true;
+            if( _singleton.exists() ) {
+               _loaded = _singleton.get();
+               _state  = _loaded;
+            }
+         }
+         return _state ? &*_state : nullptr;
+      }
+
+      const eosio_global_states* loaded()const { return _loaded ? &*_loaded : nullptr; }
+
+      void create( const eosio_global_states& state ) {
+         _read  = true;
+         _state = state;
+      }
+
+      void save( name payer ) {
+         if( _state && (!_loaded || !same_global_state( *_state, *_loaded )) )
+            _singleton.set( *_state, payer );
+      }
+
+   private:
+      global_states_singleton               _singleton;
+      bool                                  _read = false;
+      std::optional<eosio_global_states>    _state;
+      std::optional<eosio_global_states>    _loaded;
+   };
+
+   /**
+    * One of the `global` through `global4` rows, read on first access.
+    *
+    * Once the global state is merged, the row is a view into the consolidated row of `store`, which is read and
+    * written once for all four. Before that, the legacy row is read from its own singleton. `save()` writes the
+    * legacy row if it was accessed and changed, and after merging only while `mirror_legacy` is set.
+    */
+   template<typename Singleton, typename T, T eosio_global_states::*Member>
+   class lazy_global_state {
+   public:
+      lazy_global_state( name code, global_states_store& store, T (*make_default)() )
+      : _singleton( code, code.value ), _store( store ), _make_default( make_default ) {}
+
+      T& operator*()  { return get(); }
+      T* operator->() { return &get(); }
+
+      T& get() {
+         if( !_current ) {
+            if( auto* merged = _store.get() ) {
+               _current = &(merged->*Member);
+            } else {
+               if( _singleton.exists() ) _loaded = _singleton.get();
+               _state   = _loaded ? *_loaded : _make_default();
+               _current = &*_state;
+            }
+         }
+         return *_current;
+      }
+
+      // Called by mergeglobals, the legacy copy read so far is taken over by the consolidated row
+      void merged() {
+         _state.reset();
+         _loaded.reset();
+         _current = nullptr;
+      }
+
+      void save( name payer ) {
+         if( !_current )
+            return;
+         if( _state ) {
+            if( !_loaded || !same_global_state( *_state, *_loaded ) )
+               _singleton.set( *_state, payer );
+            return;
+         }
+         const auto* merged = _store.get();
+         const auto* loaded = _store.loaded();
+         if( merged->mirror_legacy && (!loaded || !same_global_state( merged->*Member, loaded->*Member )) )
+            _singleton.set( merged->*Member, payer );
+      }
+
+      void remove_legacy() {
+         if( _singleton.exists() ) _singleton.remove();
+      }
+
+      // Called by mergeglobals when mirroring is turned back on, the legacy row is written from the consolidated row
+      void restore_legacy( name payer ) {
+         _singleton.set( _store.get()->*Member, payer );
+      }
+
+   private:
+      Singleton             _singleton;
+      global_states_store&  _store;
+      T                     (*_make_default)();
+      T*                    _current = nullptr;
+      std::optional<T>      _state;
+      std::optional<T>      _loaded;
+   };
+
+   // Reads the global state of the system contract deployed to `system_account`: the consolidated row once the
+   // global state is merged, the `global` through `global4` rows before.
+   inline eosio_global_states read_global_states( name system_account ) {
+      global_states_singleton merged( system_account, system_account.value );
+      if( merged.exists() )
+         return merged.get();
+
+      eosio_global_states states;
+      global_state_singleton  global( system_account, system_account.value );
+      global_state2_singleton global2( system_account, system_account.value );
+      global_state3_singleton global3( system_account, system_account.value );
+      global_state4_singleton global4( system_account, system_account.value );
+      check( global.exists(), "global state does not exist" );
+      states.global = global.get();
+      if( global2.exists() ) states.global2 = global2.get();
+      if( global3.exists() ) states.global3 = global3.get();
+      if( global4.exists() ) states.global4 = global4.get();
+      return states;
+   }
 
    struct [[eosio::table, eosio::contract("eosio.system")]] user_resources {
       name          owner;
@@ -510,10 +835,10 @@ namespace eosiosystem {
    };
 
 
-   typedef eosio::multi_index< "userres"_n, user_resources >      user_resources_table;
-   typedef eosio::multi_index< "delband"_n, delegated_bandwidth > del_bandwidth_table;
-   typedef eosio::multi_index< "refunds"_n, refund_request >      refunds_table;
-   typedef eosio::multi_index< "giftedram"_n, gifted_ram >        gifted_ram_table;
+   typedef multi_index< "userres"_n, user_resources >      user_resources_table;
+   typedef multi_index< "delband"_n, delegated_bandwidth > del_bandwidth_table;
+   typedef multi_index< "refunds"_n, refund_request >      refunds_table;
+   typedef multi_index< "giftedram"_n, gifted_ram >        gifted_ram_table;
 
    // `rex_pool` structure underlying the rex pool table. A rex pool table entry is defined by:
    // - `version` defaulted to zero,
@@ -537,7 +862,7 @@ namespace eosiosystem {
       uint64_t primary_key()const { return 0; }
    };
 
-   typedef eosio::multi_index< "rexpool"_n, rex_pool > rex_pool_table;
+   typedef multi_index< "rexpool"_n, rex_pool > rex_pool_table;
 
    // `rex_return_pool` structure underlying the rex return pool table. A rex return pool table entry is defined by:
    // - `version` defaulted to zero,
@@ -564,7 +889,7 @@ namespace eosiosystem {
       uint64_t primary_key()const { return 0; }
    };
 
-   typedef eosio::multi_index< "rexretpool"_n, rex_return_pool > rex_return_pool_table;
+   typedef multi_index< "rexretpool"_n, rex_return_pool > rex_return_pool_table;
 
    struct pair_time_point_sec_int64 {
       time_point_sec first;
@@ -583,7 +908,7 @@ namespace eosiosystem {
       uint64_t primary_key()const { return 0; }
    };
 
-   typedef eosio::multi_index< "retbuckets"_n, rex_return_buckets > rex_return_buckets_table;
+   typedef multi_index< "retbuckets"_n, rex_return_buckets > rex_return_buckets_table;
 
    // `rex_fund` structure underlying the rex fund table. A rex fund table entry is defined by:
    // - `version` defaulted to zero,
@@ -597,7 +922,7 @@ namespace eosiosystem {
       uint64_t primary_key()const { return owner.value; }
    };
 
-   typedef eosio::multi_index< "rexfund"_n, rex_fund > rex_fund_table;
+   typedef multi_index< "rexfund"_n, rex_fund > rex_fund_table;
 
    // `rex_balance` structure underlying the rex balance table. A rex balance table entry is defined by:
    // - `version` defaulted to zero,
@@ -616,7 +941,7 @@ namespace eosiosystem {
       uint64_t primary_key()const { return owner.value; }
    };
 
-   typedef eosio::multi_index< "rexbal"_n, rex_balance > rex_balance_table;
+   typedef multi_index< "rexbal"_n, rex_balance > rex_balance_table;
 
    // `rex_loan` structure underlying the `rex_cpu_loan_table` and `rex_net_loan_table`. A rex net/cpu loan table entry is defined by:
    // - `version` defaulted to zero,
@@ -643,15 +968,15 @@ namespace eosiosystem {
       uint64_t by_owner()const    { return from.value;                 }
    };
 
-   typedef eosio::multi_index< "cpuloan"_n, rex_loan,
-                               indexed_by<"byexpr"_n,  const_mem_fun<rex_loan, uint64_t, &rex_loan::by_expr>>,
-                               indexed_by<"byowner"_n, const_mem_fun<rex_loan, uint64_t, &rex_loan::by_owner>>
-                             > rex_cpu_loan_table;
+   typedef multi_index< "cpuloan"_n, rex_loan,
+                        indexed_by<"byexpr"_n,  const_mem_fun<rex_loan, uint64_t, &rex_loan::by_expr>>,
+                        indexed_by<"byowner"_n, const_mem_fun<rex_loan, uint64_t, &rex_loan::by_owner>>
+                      > rex_cpu_loan_table;
 
-   typedef eosio::multi_index< "netloan"_n, rex_loan,
-                               indexed_by<"byexpr"_n,  const_mem_fun<rex_loan, uint64_t, &rex_loan::by_expr>>,
-                               indexed_by<"byowner"_n, const_mem_fun<rex_loan, uint64_t, &rex_loan::by_owner>>
-                             > rex_net_loan_table;
+   typedef multi_index< "netloan"_n, rex_loan,
+                        indexed_by<"byexpr"_n,  const_mem_fun<rex_loan, uint64_t, &rex_loan::by_expr>>,
+                        indexed_by<"byowner"_n, const_mem_fun<rex_loan, uint64_t, &rex_loan::by_owner>>
+                      > rex_net_loan_table;
 
    struct [[eosio::table,eosio::contract("eosio.system")]] rex_order {
       uint8_t             version = 0;
@@ -667,8 +992,8 @@ namespace eosiosystem {
       uint64_t by_time()const     { return is_open ? order_time.elapsed.count() : std::numeric_limits<uint64_t>::max(); }
    };
 
-   typedef eosio::multi_index< "rexqueue"_n, rex_order,
-                               indexed_by<"bytime"_n, const_mem_fun<rex_order, uint64_t, &rex_order::by_time>>> rex_order_table;
+   typedef multi_index< "rexqueue"_n, rex_order,
+                        indexed_by<"bytime"_n, const_mem_fun<rex_order, uint64_t, &rex_order::by_time>>> rex_order_table;
 
    struct [[eosio::table("rexmaturity"),eosio::contract("eosio.system")]] rex_maturity {
       uint32_t num_of_maturity_buckets = 5;
@@ -676,7 +1001,17 @@ namespace eosiosystem {
       bool buy_rex_to_savings = false;
    };
 
-   typedef eosio::singleton<"rexmaturity"_n, rex_maturity> rex_maturity_singleton;
+   typedef singleton<"rexmaturity"_n, rex_maturity> rex_maturity_singleton;
+
+   // Whether `runrex` reports the sellrex orders it fills with one `rex.results::orderresults` action per batch
+   // rather than one `rex.results::orderresult` action per order
+   struct [[eosio::table("rexresultcfg"), eosio::contract("eosio.system")]] rex_result_config {
+      bool aggregate_orders = false;
+
+      EOSLIB_SERIALIZE( rex_result_config, (aggregate_orders) )
+   };
+
+   typedef singleton<"rexresultcfg"_n, rex_result_config> rex_result_config_singleton;
 
    struct rex_order_outcome {
       bool success;
@@ -684,6 +1019,17 @@ namespace eosiosystem {
       asset stake_change;
    };
 
+   // Result of the `rexquote` action
+   struct rex_quote {
+      asset rex_received;   // REX received for buying REX with `payment`
+      asset proceeds;       // core tokens received for selling `rex`
+      bool  sell_fills;     // whether selling `rex` is filled right away rather than queued as a sell order
+      asset sellable_rex;   // REX of `owner` that can be sold now: matured, not in savings and not in an open sell order
+      asset rented_tokens;  // tokens staked by a cpu or net loan paid with `loan_payment`, zero if it would be rejected
+
+      EOSLIB_SERIALIZE( rex_quote, (rex_received)(proceeds)(sell_fills)(sellable_rex)(rented_tokens) )
+   };
+
    struct action_return_sellram {
       name account;
       asset quantity;
@@ -806,7 +1152,7 @@ namespace eosiosystem {
       uint64_t primary_key()const { return 0; }
    };
 
-   typedef eosio::singleton<"powup.state"_n, powerup_state> powerup_state_singleton;
+   typedef singleton<"powup.state"_n, powerup_state> powerup_state_singleton;
 
    struct [[eosio::table("powup.order"),eosio::contract("eosio.system")]] powerup_order {
       uint8_t              version = 0;
@@ -821,10 +1167,10 @@ namespace eosiosystem {
       uint64_t by_expires()const  { return expires.utc_seconds; }
    };
 
-   typedef eosio::multi_index< "powup.order"_n, powerup_order,
-                               indexed_by<"byowner"_n, const_mem_fun<powerup_order, uint64_t, &powerup_order::by_owner>>,
-                               indexed_by<"byexpires"_n, const_mem_fun<powerup_order, uint64_t, &powerup_order::by_expires>>
-                               > powerup_order_table;
+   typedef multi_index< "powup.order"_n, powerup_order,
+                        indexed_by<"byowner"_n, const_mem_fun<powerup_order, uint64_t, &powerup_order::by_owner>>,
+                        indexed_by<"byexpires"_n, const_mem_fun<powerup_order, uint64_t, &powerup_order::by_expires>>
+                        > powerup_order_table;
 
    /**
     * The `eosio.system` smart contract defines the structures and actions needed for blockchain's core functionality.
@@ -850,19 +1196,26 @@ namespace eosiosystem {
          voters_table             _voters;
          producers_table          _producers;
          producers_table2         _producers2;
+         producer_blocks_table    _producer_blocks;
          finalizer_keys_table     _finalizer_keys;
          finalizers_table         _finalizers;
          last_prop_fins_table     _last_prop_finalizers;
          std::optional<std::vector<finalizer_auth_info>> _last_prop_finalizers_cached;
+         last_prop_producers_table _last_prop_producers;
+         producer_ranking_table   _producer_ranking;
+         std::optional<producer_ranking_info> _producer_ranking_cached;
+         bool                     _producer_ranking_dirty = false;
+         vote_sets_table          _vote_sets;
+         struct weight_propagation;
+         weight_propagation*      _staged_votes = nullptr; // vote changes staged by voteupdates, applied at the end
          fin_key_id_gen_table     _fin_key_id_generator;
-         global_state_singleton   _global;
-         global_state2_singleton  _global2;
-         global_state3_singleton  _global3;
-         global_state4_singleton  _global4;
-         eosio_global_state       _gstate;
-         eosio_global_state2      _gstate2;
-         eosio_global_state3      _gstate3;
-         eosio_global_state4      _gstate4;
+         // multi_index handles above and below only hold code and scope until first used, the global state rows
+         // are likewise read on first access
+         global_states_store      _gstates;
+         lazy_global_state<global_state_singleton, eosio_global_state, &eosio_global_states::global>     _gstate;
+         lazy_global_state<global_state2_singleton, eosio_global_state2, &eosio_global_states::global2>  _gstate2;
+         lazy_global_state<global_state3_singleton, eosio_global_state3, &eosio_global_states::global3>  _gstate3;
+         lazy_global_state<global_state4_singleton, eosio_global_state4, &eosio_global_states::global4>  _gstate4;
          schedules_table          _schedules;
          rammarket                _rammarket;
          rex_pool_table           _rexpool;
@@ -1339,6 +1692,31 @@ namespace eosiosystem {
          [[eosio::action]]
          void donatetorex( const name& payer, const asset& quantity, const std::string& memo );
 
+         /**
+          * Choose how filled sellrex orders are reported when they are processed from the queue.
+          *
+          * @param aggregate - if true, each batch of orders filled by a REX action is reported by a single
+          *    `rex.results::orderresults` action listing the owner and proceeds of every order; if false, every
+          *    filled order is reported by its own `rex.results::orderresult` action.
+          */
+         [[eosio::action]]
+         void cfgrexresult( bool aggregate );
+
+         /**
+          * Quotes REX purchases, sales and loans at the current REX pool state, including the returns the next REX
+          * action distributes. Expired loans and queued sell orders the next REX action processes are not taken into
+          * account. Meant to be called in a read-only transaction.
+          *
+          * @param owner - account whose REX balance limits the REX that can be sold, may be empty.
+          * @param payment - amount of core tokens to buy REX with, may be zero.
+          * @param rex - amount of REX to sell, may be zero.
+          * @param loan_payment - payment of a `rentcpu` or `rentnet` loan, may be zero.
+          *
+          * @return rex_quote - see `rex_quote`
+          */
+         [[eosio::action]]
+         rex_quote rexquote( const name& owner, const asset& payment, const asset& rex, const asset& loan_payment );
+
          /**
           * Undelegate bandwidth action, decreases the total tokens delegated by `from` to `receiver` and/or
           * frees the memory associated with the delegation if there is nothing
@@ -1702,6 +2080,17 @@ namespace eosiosystem {
          [[eosio::action]]
          void voteupdate( const name& voter_name );
 
+         /**
+          * Update the vote weight of several voters at once, as `voteupdate` does for each of them. The changes of
+          * all the voters are accumulated so that every affected producer and proxy is only updated once.
+          *
+          * @param voter_names - the accounts to update the votes for, each of them must authorize the action
+          *
+          * @post the same as `voteupdate` for each of the `voter_names`
+          */
+         [[eosio::action]]
+         void voteupdates( const std::vector<name>& voter_names );
+
          /**
           * Register proxy action, sets `proxy` account as proxy.
           * An account marked as a proxy can vote with the weight of other accounts which
@@ -1830,6 +2219,54 @@ namespace eosiosystem {
          [[eosio::action]]
          void setpayfactor( int64_t inflation_pay_factor, int64_t votepay_factor );
 
+         /**
+          * Merge the `global`, `global2`, `global3` and `global4` rows into the single `globalstate` row, so that
+          * actions read and write the global state once. May be called again to change `mirror_legacy`.
+          *
+          * @param mirror_legacy - if true, changes keep being written to the `global` through `global4` rows as well
+          *    for consumers that have not switched to `globalstate` yet; if false, those rows are removed. Turning
+          *    mirroring back on writes all four rows again from `globalstate`.
+          */
+         [[eosio::action]]
+         void mergeglobals( bool mirror_legacy );
+
+         /**
+          * Set the number of recent blocks recorded in the `blockinfo` table.
+          *
+          * @param rolling_window_size - number of blocks kept in the rolling window, between 1 and
+          *    `block_info::max_rolling_window_size`; recorded blocks still within the new window are kept.
+          */
+         [[eosio::action]]
+         void setblockinfo( uint32_t rolling_window_size );
+
+         /**
+          * Returns the ranking of the producers with the most votes, see `producer_ranking_info`.
+          * Meant to be called in a read-only transaction.
+          */
+         [[eosio::action]]
+         std::vector<ranked_producer> getranking();
+
+         /**
+          * Enable or disable storing the producers voted for in the shared `votesets` table. Voters switch to the
+          * new setting the next time they vote or call `voteupdate`.
+          *
+          * @param enabled - if true, the producers of new votes are stored once per distinct set and referenced by
+          *    id from the `voters` rows; if false, they are stored in the `voters` rows again.
+          */
+         [[eosio::action]]
+         void cfgvotesets( bool enabled );
+
+         /**
+          * Enable or disable deferred vote tallying. While enabled, votes only record the resulting changes of the
+          * producers' votes in the `votetally` table, which are applied to the `producers` table before the next
+          * producer schedule update or reward claim, so `total_votes` may lag behind by up to a minute.
+          *
+          * @param deferred - if true, the vote changes are deferred; if false, the pending changes are applied and
+          *    votes update the producers directly again.
+          */
+         [[eosio::action]]
+         void cfgvotetally( bool deferred );
+
          /**
           * Set the schedule for pre-determined annual rate changes.
           *
@@ -1948,6 +2385,8 @@ namespace eosiosystem {
          using consolidate_action  = eosio::action_wrapper<"consolidate"_n, &system_contract::consolidate>;
          using closerex_action     = eosio::action_wrapper<"closerex"_n, &system_contract::closerex>;
          using donatetorex_action  = eosio::action_wrapper<"donatetorex"_n, &system_contract::donatetorex>;
+         using cfgrexresult_action = eosio::action_wrapper<"cfgrexresult"_n, &system_contract::cfgrexresult>;
+         using rexquote_action     = eosio::action_wrapper<"rexquote"_n, &system_contract::rexquote>;
          using undelegatebw_action = eosio::action_wrapper<"undelegatebw"_n, &system_contract::undelegatebw>;
          using buyram_action       = eosio::action_wrapper<"buyram"_n, &system_contract::buyram>;
          using buyrambytes_action  = eosio::action_wrapper<"buyrambytes"_n, &system_contract::buyrambytes>;
@@ -1968,6 +2407,7 @@ namespace eosiosystem {
          using setramrate_action   = eosio::action_wrapper<"setramrate"_n, &system_contract::setramrate>;
          using voteproducer_action = eosio::action_wrapper<"voteproducer"_n, &system_contract::voteproducer>;
          using voteupdate_action   = eosio::action_wrapper<"voteupdate"_n, &system_contract::voteupdate>;
+         using voteupdates_action  = eosio::action_wrapper<"voteupdates"_n, &system_contract::voteupdates>;
          using regproxy_action     = eosio::action_wrapper<"regproxy"_n, &system_contract::regproxy>;
          using claimrewards_action = eosio::action_wrapper<"claimrewards"_n, &system_contract::claimrewards>;
          using rmvproducer_action  = eosio::action_wrapper<"rmvproducer"_n, &system_contract::rmvproducer>;
@@ -1979,6 +2419,11 @@ namespace eosiosystem {
          using setparams_action    = eosio::action_wrapper<"setparams"_n, &system_contract::setparams>;
          using setinflation_action = eosio::action_wrapper<"setinflation"_n, &system_contract::setinflation>;
          using setpayfactor_action = eosio::action_wrapper<"setpayfactor"_n, &system_contract::setpayfactor>;
+         using mergeglobals_action = eosio::action_wrapper<"mergeglobals"_n, &system_contract::mergeglobals>;
+         using setblockinfo_action = eosio::action_wrapper<"setblockinfo"_n, &system_contract::setblockinfo>;
+         using getranking_action   = eosio::action_wrapper<"getranking"_n, &system_contract::getranking>;
+         using cfgvotesets_action  = eosio::action_wrapper<"cfgvotesets"_n, &system_contract::cfgvotesets>;
+         using cfgvotetally_action = eosio::action_wrapper<"cfgvotetally"_n, &system_contract::cfgvotetally>;
          using cfgpowerup_action   = eosio::action_wrapper<"cfgpowerup"_n, &system_contract::cfgpowerup>;
          using powerupexec_action  = eosio::action_wrapper<"powerupexec"_n, &system_contract::powerupexec>;
          using powerup_action      = eosio::action_wrapper<"powerup"_n, &system_contract::powerup>;
@@ -1991,6 +2436,8 @@ namespace eosiosystem {
          //defined in eosio.system.cpp
          static eosio_global_state get_default_parameters();
          static eosio_global_state4 get_default_inflation_parameters();
+         static eosio_global_state2 get_default_state2() { return {}; }
+         static eosio_global_state3 get_default_state3() { return {}; }
          symbol core_symbol()const;
          void update_ram_supply();
          void channel_to_system_fees( const name& from, const asset& amount );
@@ -1999,9 +2446,13 @@ namespace eosiosystem {
          // defined in rex.cpp
          void runrex( uint16_t max );
          void update_rex_pool();
+         int64_t advance_rex_return_pool( rex_return_pool& rp, std::optional<rex_return_buckets>& buckets );
          void update_resource_limits( const name& from, const name& receiver, int64_t delta_net, int64_t delta_cpu );
-         rex_order_outcome fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex );
-         asset update_rex_account( const name& owner, const asset& proceeds, const asset& unstake_quant, bool force_vote_update = false );
+         rex_order_outcome fill_rex_order( rex_balance& rb, const asset& rex );
+         asset update_rex_account( const name& owner, const asset& proceeds, const asset& unstake_quant, bool force_vote_update = false,
+                                   int64_t delegated_stake_delta = 0 );
+         asset settle_rex_order( const name& owner, const asset& proceeds, asset& stake_change );
+         asset refresh_rex_vote_stake( const name& owner );
          template <typename T>
          int64_t rent_rex( T& table, const name& from, const name& receiver, const asset& loan_payment, const asset& loan_fund );
          template <typename T>
@@ -2015,13 +2466,14 @@ namespace eosiosystem {
          asset add_to_rex_balance( const name& owner, const asset& payment, const asset& rex_received );
          asset add_to_rex_pool( const asset& payment );
          void add_to_rex_return_pool( const asset& fee );
-         void process_rex_maturities( const rex_balance_table::const_iterator& bitr );
+         void process_rex_maturities( rex_balance& rb );
          void process_sell_matured_rex( const name owner );
          void process_buy_rex_to_savings( const name owner, const asset rex );
          void consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                        const asset& rex_in_sell_order );
-         int64_t read_rex_savings( const rex_balance_table::const_iterator& bitr );
-         void put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex );
+         int64_t read_rex_savings( rex_balance& rb );
+         void put_rex_savings( rex_balance& rb, int64_t rex );
+         void store_rex_balance( const rex_balance_table::const_iterator& bitr, const rex_balance& rb );
          void update_rex_stake( const name& voter );
          void sell_rex( const name& from, const asset& rex );
 
@@ -2033,23 +2485,92 @@ namespace eosiosystem {
          // defined in delegate_bandwidth.cpp
          void changebw( name from, const name& receiver,
                         const asset& stake_net_quantity, const asset& stake_cpu_quantity, bool transfer );
-         int64_t update_voting_power( const name& voter, const asset& total_update );
+         int64_t update_voting_power( const name& voter, const asset& total_update, int64_t delegated_stake_delta = 0 );
          void set_resource_ram_bytes_limits( const name& owner, int64_t bytes );
          int64_t reduce_ram( const name& owner, int64_t bytes );
          int64_t add_ram( const name& owner, int64_t bytes );
          void update_stake_delegated( const name from, const name receiver, const asset stake_net_delta, const asset stake_cpu_delta );
+         // Stake changes of a voter, written to its row together with its vote by stage_votes
+         struct voter_stake_update {
+            int64_t              staked_delta          = 0;
+            int64_t              delegated_stake_delta = 0; // applied once the delegated stake total is tracked
+            std::optional<asset> delegated_stake_total;     // starts tracking the total with this value
+
+            void apply( voter_info& voter ) const;
+         };
+         int64_t get_delegated_stake_total( const voters_table::const_iterator& voter_itr, voter_stake_update& stake );
          void update_user_resources( const name from, const name receiver, const asset stake_net_delta, const asset stake_cpu_delta );
 
          // defined in voting.cpp
          void register_producer( const name& producer, const eosio::block_signing_authority& producer_authority, const std::string& url, uint16_t location );
          void update_elected_producers( const block_timestamp& timestamp );
-         void update_votes( const name& voter, const name& proxy, const std::vector<name>& producers, bool voting );
-         void propagate_weight_change( const voter_info& voter );
+         bool top_producers_unchanged( const last_prop_producers_info& last_prop );
+         void invalidate_visited_producers();
+         // Vote weight changes of voters and producers accumulated in memory, see propagate_weight_changes
+         struct weight_propagation {
+            struct pending_voter {
+               name                  owner;
+               double                proxied_vote_weight_delta = 0;
+               std::optional<bool>   is_proxy;          // new value, if changed by the action
+               std::optional<double> last_vote_weight;  // new value, once a change has been propagated
+               bool                  resolved = false;
+            };
+
+            struct pending_producer {
+               name   owner;
+               double vote_delta         = 0;
+               bool   must_be_registered = false; // part of a new vote
+               bool   must_be_active     = false; // part of a new vote cast by voteproducer or voteupdate
+            };
+
+            std::vector<pending_voter>    voters;    // in order of first change
+            std::vector<pending_producer> producers; // sorted by owner
+
+            pending_voter& voter( const name& owner );
+            void add_proxied_vote_weight( const name& proxy, double delta );
+            void add_producer_votes( const name& producer, double delta, bool new_vote = false, bool voting = false );
+            void add_producer_votes( const pending_producer* deltas, size_t count );
+         };
+         void update_votes( const name& voter, const name& proxy, const std::vector<name>& producers, bool voting,
+                            const voter_stake_update& stake = {} );
+         const std::vector<name>& get_voted_producers( const voter_info& voter );
+         uint32_t retain_vote_set( const std::vector<name>& producers );
+         void release_vote_set( uint32_t id );
+         void stage_votes( weight_propagation& changes, const name& voter, const name& proxy, const std::vector<name>& producers, bool voting,
+                           const voter_stake_update& stake = {} );
+         void propagate_weight_changes( weight_propagation& changes );
+         void apply_producer_vote_deltas( const std::vector<producer_vote_delta>& deltas );
+         void flush_vote_tally();
          double update_producer_votepay_share( const producers_table2::const_iterator& prod_itr,
                                                const time_point& ct,
                                                double shares_rate, bool reset_to_zero = false );
          double update_total_votepay_share( const time_point& ct,
                                             double additional_shares_delta = 0.0, double shares_rate_delta = 0.0 );
+         const producer_ranking_info& get_producer_ranking();
+         void update_producer_ranking( const producer_info& prod );
+         void save_producer_ranking();
+
+         // Calls `visit` with each active producer with votes in descending order of votes until it returns false.
+         // The producers are taken from the producer ranking; the `prototalvote` index is only walked past the
+         // ranked producers.
+         template<typename Visitor>
+         void visit_top_producers( Visitor&& visit ) {
+            const auto& ranking = get_producer_ranking().producers;
+            const producer_info* last = nullptr;
+            for( const auto& r : ranking ) {
+               if( !r.is_active ) continue;
+               if( r.total_votes <= 0 ) return;
+               last = &_producers.get( r.owner.value, "ranked producer not found" ); //data corruption
+               if( !visit( *last ) ) return;
+            }
+            if( ranking.size() < producer_ranking_size ) return;
+
+            auto idx = _producers.get_index<"prototalvote"_n>();
+            auto it  = last ? ++idx.iterator_to( *last ) : idx.cbegin();
+            for( ; it != idx.cend() && 0 < it->total_votes && it->active(); ++it ) {
+               if( !visit( *it ) ) return;
+            }
+         }
 
          // defined in finalizer_key.cpp
          bool is_savanna_consensus();
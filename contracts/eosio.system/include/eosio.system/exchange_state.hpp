@@ -3,6 +3,8 @@
 #include <eosio/asset.hpp>
 #include <eosio/multi_index.hpp>
 
+#include <eosio.system/db_profiler.hpp>
+
 namespace eosiosystem {
 
    using eosio::asset;
@@ -44,5 +46,5 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( exchange_state, (supply)(base)(quote) )
    };
 
-   typedef eosio::multi_index< "rammarket"_n, exchange_state > rammarket;
+   typedef multi_index< "rammarket"_n, exchange_state > rammarket;
 } /// namespace eosiosystem
@@ -2,6 +2,8 @@
 
 #include <eosio/multi_index.hpp>
 
+#include <eosio.system/db_profiler.hpp>
+
 namespace eosiosystem {
    using eosio::name;
 
@@ -16,5 +18,5 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE(limit_auth_change, (version)(account)(allow_perms)(disallow_perms))
    };
 
-   typedef eosio::multi_index<"limitauthchg"_n, limit_auth_change> limit_auth_change_table;
+   typedef multi_index<"limitauthchg"_n, limit_auth_change> limit_auth_change_table;
 } // namespace eosiosystem
@@ -4,6 +4,8 @@
 #include <eosio/crypto.hpp>
 #include <eosio/name.hpp>
 
+#include <eosio.system/db_profiler.hpp>
+
 #include <string>
 #include <optional>
 
@@ -35,7 +37,7 @@ struct [[eosio::table("peerkeys"), eosio::contract("eosio.system")]] peer_key {
 
 // -------------------------------------------------------------------------------------------------
 // -------------------------------------------------------------------------------------------------
-typedef eosio::multi_index<"peerkeys"_n, peer_key> peer_keys_table;
+typedef multi_index<"peerkeys"_n, peer_key> peer_keys_table;
 
 // -------------------------------------------------------------------------------------------------
 // -------------------------------------------------------------------------------------------------
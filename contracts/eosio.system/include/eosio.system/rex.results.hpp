@@ -4,12 +4,24 @@
 #include <eosio/eosio.hpp>
 #include <eosio/name.hpp>
 
+#include <vector>
+
 using eosio::action_wrapper;
 using eosio::asset;
 using eosio::name;
 
 /**
- * The actions `buyresult`, `sellresult`, `rentresult`, and `orderresult` of `rex.results` are all no-ops.
+ * Owner and proceeds of a sellrex order filled from the queue.
+ */
+struct order_result {
+   name  owner;
+   asset proceeds;
+
+   EOSLIB_SERIALIZE( order_result, (owner)(proceeds) )
+};
+
+/**
+ * The actions `buyresult`, `sellresult`, `rentresult`, `orderresult`, and `orderresults` of `rex.results` are all no-ops.
  * They are added as inline convenience actions to `rentnet`, `rentcpu`, `buyrex`, `unstaketorex`, and `sellrex`.
  * An inline convenience action does not have any effect, however,
  * its data includes the result of the parent action and appears in its trace.
@@ -44,6 +56,15 @@ class [[eosio::contract("rex.results")]] rex_results : eosio::contract {
       [[eosio::action]]
       void orderresult( const name& owner, const asset& proceeds );
 
+      /**
+       * Orderresults action, sent once per batch of filled sellrex orders instead of one `orderresult`
+       * per order when enabled by `cfgrexresult`.
+       *
+       * @param results - owner and proceeds of each filled order, in the order they were filled
+       */
+      [[eosio::action]]
+      void orderresults( const std::vector<order_result>& results );
+
       /**
        * Rentresult action.
        *
@@ -55,5 +76,6 @@ class [[eosio::contract("rex.results")]] rex_results : eosio::contract {
       using buyresult_action   = action_wrapper<"buyresult"_n,   &rex_results::buyresult>;
       using sellresult_action  = action_wrapper<"sellresult"_n,  &rex_results::sellresult>;
       using orderresult_action = action_wrapper<"orderresult"_n, &rex_results::orderresult>;
+      using orderresults_action = action_wrapper<"orderresults"_n, &rex_results::orderresults>;
       using rentresult_action  = action_wrapper<"rentresult"_n,  &rex_results::rentresult>;
 };
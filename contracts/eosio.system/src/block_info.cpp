@@ -10,6 +10,26 @@ inline uint32_t block_height_from_id(const eosio::checksum256& block_id)
    return ((arr[0] << 0x18) | (arr[1] << 0x10) | (arr[2] << 0x08) | arr[3]);
 }
 
+namespace block_info = eosiosystem::block_info;
+
+// Returns the position of the blockinfo ring, or a new ring with `window_size` slots if it does not exist yet.
+// The rows left by the one-row-per-block layout of the table are erased when the ring is created.
+block_info::block_info_ring get_or_create_ring(block_info::block_info_ring_singleton& ring_singleton,
+                                               block_info::block_info_table&          t,
+                                               uint32_t                               window_size)
+{
+   if (ring_singleton.exists()) {
+      return ring_singleton.get();
+   }
+
+   block_info::legacy_block_info_table legacy(t.get_code(), t.get_scope());
+   for (auto legacy_itr = legacy.begin(); legacy_itr != legacy.end();) {
+      legacy_itr = legacy.erase(legacy_itr);
+   }
+
+   return block_info::block_info_ring{.window_size = window_size};
+}
+
 } // namespace
 
 namespace eosiosystem {
@@ -17,31 +37,59 @@ namespace eosiosystem {
 void system_contract::add_to_blockinfo_table(const eosio::checksum256&    previous_block_id,
                                              const eosio::block_timestamp timestamp) const
 {
-   const uint32_t new_block_height    = block_height_from_id(previous_block_id) + 1;
-   const auto     new_block_timestamp = static_cast<eosio::time_point>(timestamp);
+   const uint32_t new_block_height = block_height_from_id(previous_block_id) + 1;
 
-   block_info::block_info_table t(get_self(), 0);
+   block_info::block_info_ring_singleton ring_singleton(get_self(), 0);
+   block_info::block_info_table          t(get_self(), 0);
 
-   if (block_info::rolling_window_size > 0) {
-      // Add new entry to blockinfo table for the new block.
-      t.emplace(get_self(), [&](block_info::block_info_record& r) {
-         r.block_height    = new_block_height;
-         r.block_timestamp = new_block_timestamp;
-      });
+   auto ring                = get_or_create_ring(ring_singleton, t, block_info::rolling_window_size);
+   ring.latest_block_height = new_block_height;
+   ring_singleton.set(ring, get_self());
+
+   // Overwrite the record of the block that falls out of the rolling window with the new block.
+   const uint32_t slot   = ring.slot(new_block_height);
+   auto           update = [&](block_info::block_info_slot& r) {
+      r.slot            = slot;
+      r.block_height    = new_block_height;
+      r.block_timestamp = timestamp;
+   };
+   if (auto itr = t.find(slot); itr != t.end()) {
+      t.modify(itr, same_payer, update);
+   } else {
+      t.emplace(get_self(), update);
    }
+}
+
+void system_contract::setblockinfo(uint32_t rolling_window_size)
+{
+   require_auth(get_self());
+
+   check(0 < rolling_window_size && rolling_window_size <= block_info::max_rolling_window_size,
+         "rolling_window_size must be between 1 and " + std::to_string(block_info::max_rolling_window_size));
 
-   // Erase up to two entries that have fallen out of the rolling window.
+   block_info::block_info_ring_singleton ring_singleton(get_self(), 0);
+   block_info::block_info_table          t(get_self(), 0);
 
-   const uint32_t last_prunable_block_height =
-      std::max(new_block_height, block_info::rolling_window_size) - block_info::rolling_window_size;
+   auto ring = get_or_create_ring(ring_singleton, t, rolling_window_size);
 
-   int count = 2;
-   for (auto itr = t.begin(), end = t.end();                                        //
-        itr != end && itr->block_height <= last_prunable_block_height && 0 < count; //
-        --count)                                                                    //
-   {
+   // Keep the recorded blocks that are still within the new window, moved to their slot in the resized ring.
+   std::vector<block_info::block_info_slot> kept;
+   for (auto itr = t.begin(); itr != t.end();) {
+      if (uint64_t{itr->block_height} + rolling_window_size > uint64_t{ring.latest_block_height}) {
+         kept.push_back(*itr);
+      }
       itr = t.erase(itr);
    }
+
+   ring.window_size = rolling_window_size;
+   ring_singleton.set(ring, get_self());
+
+   for (const auto& record : kept) {
+      t.emplace(get_self(), [&](block_info::block_info_slot& r) {
+         r      = record;
+         r.slot = ring.slot(record.block_height);
+      });
+   }
 }
 
-} // namespace eosiosystem
\ No newline at end of file
+} // namespace eosiosystem
@@ -84,8 +84,8 @@ namespace eosiosystem {
 
       check( bytes_out > 0, "must reserve a positive amount" );
 
-      _gstate.total_ram_bytes_reserved += uint64_t(bytes_out);
-      _gstate.total_ram_stake          += quant_after_fee.amount;
+      _gstate->total_ram_bytes_reserved += uint64_t(bytes_out);
+      _gstate->total_ram_stake          += quant_after_fee.amount;
 
       const int64_t ram_bytes = add_ram( receiver, bytes_out );
 
@@ -127,11 +127,11 @@ namespace eosiosystem {
 
       check( tokens_out.amount > 1, "token amount received from selling ram is too low" );
 
-      _gstate.total_ram_bytes_reserved -= static_cast<decltype(_gstate.total_ram_bytes_reserved)>(bytes); // bytes > 0 is asserted above
-      _gstate.total_ram_stake          -= tokens_out.amount;
+      _gstate->total_ram_bytes_reserved -= static_cast<decltype(_gstate->total_ram_bytes_reserved)>(bytes); // bytes > 0 is asserted above
+      _gstate->total_ram_stake          -= tokens_out.amount;
 
       //// this shouldn't happen, but just in case it does we should prevent it
-      check( _gstate.total_ram_stake >= 0, "error, attempt to unstake more tokens than previously staked" );
+      check( _gstate->total_ram_stake >= 0, "error, attempt to unstake more tokens than previously staked" );
 
       {
          token::transfer_action transfer_act{ token_account, { {ram_account, active_permission}, {account, active_permission} } };
@@ -431,7 +431,7 @@ namespace eosiosystem {
       }
 
       vote_stake_updater( from );
-      const int64_t staked = update_voting_power( from, stake_net_delta + stake_cpu_delta );
+      const int64_t staked = update_voting_power( from, stake_net_delta + stake_cpu_delta, (stake_net_delta + stake_cpu_delta).amount );
       if ( from == "b1"_n ) {
          validate_b1_vesting( staked, stake_net_delta + stake_cpu_delta );
       }
@@ -459,6 +459,35 @@ namespace eosiosystem {
       if ( itr->is_empty() ) {
          del_tbl.erase( itr );
       }
+      // the delegated stake total of `from` is adjusted by the update_voting_power call that follows
+   }
+
+   void system_contract::voter_stake_update::apply( voter_info& voter ) const
+   {
+      voter.staked += staked_delta;
+      if ( delegated_stake_total ) {
+         voter.flags1    = set_field( voter.flags1, voter_info::flags1_fields::delegated_stake );
+         voter.reserved3 = *delegated_stake_total;
+      } else if ( has_field( voter.flags1, voter_info::flags1_fields::delegated_stake ) ) {
+         voter.reserved3.amount += delegated_stake_delta;
+      }
+   }
+
+   int64_t system_contract::get_delegated_stake_total( const voters_table::const_iterator& voter_itr, voter_stake_update& stake )
+   {
+      if ( has_field( voter_itr->flags1, voter_info::flags1_fields::delegated_stake ) ) {
+         return voter_itr->reserved3.amount;
+      }
+
+      // first use, sum up the delegated bandwidth once; `stake` stores the total with the next write of the voter row
+      // and it is kept up to date from then on
+      int64_t total = 0;
+      del_bandwidth_table del_tbl( get_self(), voter_itr->owner.value );
+      for ( auto del_itr = del_tbl.begin(); del_itr != del_tbl.end(); ++del_itr ) {
+         total += del_itr->net_weight.amount + del_itr->cpu_weight.amount;
+      }
+      stake.delegated_stake_total = asset( total, core_symbol() );
+      return total;
    }
 
    void system_contract::update_user_resources( const name from, const name receiver, const asset stake_net_delta, const asset stake_cpu_delta )
@@ -508,7 +537,7 @@ namespace eosiosystem {
       } // tot_itr can be invalid, should go out of scope
    }
 
-   int64_t system_contract::update_voting_power( const name& voter, const asset& total_update )
+   int64_t system_contract::update_voting_power( const name& voter, const asset& total_update, int64_t delegated_stake_delta )
    {
       auto voter_itr = _voters.find( voter.value );
       if( voter_itr == _voters.end() ) {
@@ -516,18 +545,24 @@ namespace eosiosystem {
             v.owner  = voter;
             v.staked = total_update.amount;
          });
-      } else {
-         _voters.modify( voter_itr, same_payer, [&]( auto& v ) {
-            v.staked += total_update.amount;
-         });
+         check( 0 <= voter_itr->staked, "stake for voting cannot be negative" );
+         return voter_itr->staked;
       }
 
-      check( 0 <= voter_itr->staked, "stake for voting cannot be negative" );
+      const int64_t staked = voter_itr->staked + total_update.amount;
+      check( 0 <= staked, "stake for voting cannot be negative" );
 
-      if( voter_itr->producers.size() || voter_itr->proxy ) {
-         update_votes( voter, voter_itr->proxy, voter_itr->producers, false );
+      // the voter row is written once, together with the vote if the stake changes one
+      const voter_stake_update stake{ .staked_delta = total_update.amount, .delegated_stake_delta = delegated_stake_delta };
+      const auto producers = get_voted_producers( *voter_itr );
+      if( producers.size() || voter_itr->proxy ) {
+         update_votes( voter, voter_itr->proxy, producers, false, stake );
+      } else {
+         _voters.modify( voter_itr, same_payer, [&]( auto& v ) {
+            stake.apply( v );
+         });
       }
-      return voter_itr->staked;
+      return staked;
    }
 
    void system_contract::delegatebw( const name& from, const name& receiver,
@@ -550,7 +585,7 @@ namespace eosiosystem {
       check( unstake_cpu_quantity >= zero_asset, "must unstake a positive amount" );
       check( unstake_net_quantity >= zero_asset, "must unstake a positive amount" );
       check( unstake_cpu_quantity.amount + unstake_net_quantity.amount > 0, "must unstake a positive amount" );
-      check( _gstate.thresh_activated_stake_time != time_point(),
+      check( _gstate->thresh_activated_stake_time != time_point(),
              "cannot undelegate bandwidth until the chain is activated (at least 15% of all tokens participate in voting)" );
 
       changebw( from, receiver, -unstake_net_quantity, -unstake_cpu_quantity, false);
@@ -583,7 +618,7 @@ namespace eosiosystem {
       check( unvesting.amount <= total_vesting - vested , "can only unvest what is not already vested");
 
       // reduce staked from account
-      update_voting_power( account, -unvesting );
+      update_voting_power( account, -unvesting, -unvesting.amount );
       update_stake_delegated( account, account, -unvest_net_quantity, -unvest_cpu_quantity );
       update_user_resources( account, account, -unvest_net_quantity, -unvest_cpu_quantity );
       vote_stake_updater( account );
@@ -21,14 +21,19 @@ namespace eosiosystem {
     _voters(get_self(), get_self().value),
     _producers(get_self(), get_self().value),
     _producers2(get_self(), get_self().value),
+    _producer_blocks(get_self(), get_self().value),
     _finalizer_keys(get_self(), get_self().value),
     _finalizers(get_self(), get_self().value),
     _last_prop_finalizers(get_self(), get_self().value),
+    _last_prop_producers(get_self(), get_self().value),
+    _producer_ranking(get_self(), get_self().value),
+    _vote_sets(get_self(), get_self().value),
     _fin_key_id_generator(get_self(), get_self().value),
-    _global(get_self(), get_self().value),
-    _global2(get_self(), get_self().value),
-    _global3(get_self(), get_self().value),
-    _global4(get_self(), get_self().value),
+    _gstates(get_self()),
+    _gstate(get_self(), _gstates, &get_default_parameters),
+    _gstate2(get_self(), _gstates, &get_default_state2),
+    _gstate3(get_self(), _gstates, &get_default_state3),
+    _gstate4(get_self(), _gstates, &get_default_inflation_parameters),
     _schedules(get_self(), get_self().value),
     _rammarket(get_self(), get_self().value),
     _rexpool(get_self(), get_self().value),
@@ -39,10 +44,6 @@ namespace eosiosystem {
     _rexorders(get_self(), get_self().value),
     _rexmaturity(get_self(), get_self().value)
    {
-      _gstate  = _global.exists() ? _global.get() : get_default_parameters();
-      _gstate2 = _global2.exists() ? _global2.get() : eosio_global_state2{};
-      _gstate3 = _global3.exists() ? _global3.get() : eosio_global_state3{};
-      _gstate4 = _global4.exists() ? _global4.get() : get_default_inflation_parameters();
    }
 
    eosio_global_state system_contract::get_default_parameters() {
@@ -65,20 +66,25 @@ namespace eosiosystem {
    }
 
    system_contract::~system_contract() {
-      _global.set( _gstate, get_self() );
-      _global2.set( _gstate2, get_self() );
-      _global3.set( _gstate3, get_self() );
-      _global4.set( _gstate4, get_self() );
+      save_producer_ranking();
+      _gstate.save( get_self() );
+      _gstate2.save( get_self() );
+      _gstate3.save( get_self() );
+      _gstate4.save( get_self() );
+      _gstates.save( get_self() );
+#ifdef SYSTEM_PROFILE_DB_ACCESS
+      profiling::report();
+#endif
    }
 
    void system_contract::setram( uint64_t max_ram_size ) {
       require_auth( get_self() );
 
-      check( _gstate.max_ram_size < max_ram_size, "ram may only be increased" ); /// decreasing ram might result market maker issues
+      check( _gstate->max_ram_size < max_ram_size, "ram may only be increased" ); /// decreasing ram might result market maker issues
       check( max_ram_size < 1024ll*1024*1024*1024*1024, "ram size is unrealistic" );
-      check( max_ram_size > _gstate.total_ram_bytes_reserved, "attempt to set max below reserved" );
+      check( max_ram_size > _gstate->total_ram_bytes_reserved, "attempt to set max below reserved" );
 
-      auto delta = int64_t(max_ram_size) - int64_t(_gstate.max_ram_size);
+      auto delta = int64_t(max_ram_size) - int64_t(_gstate->max_ram_size);
       auto itr = _rammarket.find(ramcore_symbol.raw());
 
       /**
@@ -88,18 +94,18 @@ namespace eosiosystem {
          m.base.balance.amount += delta;
       });
 
-      _gstate.max_ram_size = max_ram_size;
+      _gstate->max_ram_size = max_ram_size;
    }
 
    void system_contract::update_ram_supply() {
       auto cbt = eosio::current_block_time();
 
-      if( cbt <= _gstate2.last_ram_increase ) return;
+      if( cbt <= _gstate2->last_ram_increase ) return;
 
-      if (_gstate2.new_ram_per_block != 0) {
+      if (_gstate2->new_ram_per_block != 0) {
          auto itr     = _rammarket.find(ramcore_symbol.raw());
-         auto new_ram = (cbt.slot - _gstate2.last_ram_increase.slot) * _gstate2.new_ram_per_block;
-         _gstate.max_ram_size += new_ram;
+         auto new_ram = (cbt.slot - _gstate2->last_ram_increase.slot) * _gstate2->new_ram_per_block;
+         _gstate->max_ram_size += new_ram;
 
          /**
           *  Increase the amount of ram for sale based upon the change in max ram size.
@@ -107,14 +113,14 @@ namespace eosiosystem {
          _rammarket.modify(itr, same_payer, [&](auto& m) { m.base.balance.amount += new_ram; });
       }
 
-      _gstate2.last_ram_increase = cbt;
+      _gstate2->last_ram_increase = cbt;
    }
 
    void system_contract::setramrate( uint16_t bytes_per_block ) {
       require_auth( get_self() );
 
       update_ram_supply(); // make sure all previous blocks are accounted at the old rate before updating the rate
-      _gstate2.new_ram_per_block = bytes_per_block;
+      _gstate2->new_ram_per_block = bytes_per_block;
    }
 
    void system_contract::channel_to_system_fees( const name& from, const asset& amount ) {
@@ -128,8 +134,8 @@ namespace eosiosystem {
 
    void system_contract::setparams( const blockchain_parameters_t& params ) {
       require_auth( get_self() );
-      (eosio::blockchain_parameters&)(_gstate) = params;
-      check( 3 <= _gstate.max_authority_depth, "max_authority_depth should be at least 3" );
+      (eosio::blockchain_parameters&)(*_gstate) = params;
+      check( 3 <= _gstate->max_authority_depth, "max_authority_depth should be at least 3" );
 #ifndef SYSTEM_BLOCKCHAIN_PARAMETERS
       set_blockchain_parameters( params );
 #else
@@ -511,15 +517,16 @@ namespace eosiosystem {
       _producers.modify( prod, same_payer, [&](auto& p) {
             p.deactivate();
          });
+      update_producer_ranking( *prod );
    }
 
    void system_contract::updtrevision( uint8_t revision ) {
       require_auth( get_self() );
-      check( _gstate2.revision < 255, "can not increment revision" ); // prevent wrap around
-      check( revision == _gstate2.revision + 1, "can only increment revision by one" );
+      check( _gstate2->revision < 255, "can not increment revision" ); // prevent wrap around
+      check( revision == _gstate2->revision + 1, "can only increment revision by one" );
       check( revision <= 1, // set upper bound to greatest revision supported in the code
              "specified revision is not yet supported by the code" );
-      _gstate2.revision = revision;
+      _gstate2->revision = revision;
    }
 
    void system_contract::setinflation( int64_t annual_rate, int64_t inflation_pay_factor, int64_t votepay_factor ) {
@@ -531,10 +538,9 @@ namespace eosiosystem {
       if ( votepay_factor < pay_factor_precision ) {
          check( false, "votepay_factor must not be less than " + std::to_string(pay_factor_precision) );
       }
-      _gstate4.continuous_rate      = get_continuous_rate(annual_rate);
-      _gstate4.inflation_pay_factor = inflation_pay_factor;
-      _gstate4.votepay_factor       = votepay_factor;
-      _global4.set( _gstate4, get_self() );
+      _gstate4->continuous_rate      = get_continuous_rate(annual_rate);
+      _gstate4->inflation_pay_factor = inflation_pay_factor;
+      _gstate4->votepay_factor       = votepay_factor;
    }
 
    void system_contract::setpayfactor( int64_t inflation_pay_factor, int64_t votepay_factor ) {
@@ -545,9 +551,42 @@ namespace eosiosystem {
       if ( votepay_factor < pay_factor_precision ) {
          check( false, "votepay_factor must not be less than " + std::to_string(pay_factor_precision) );
       }
-      _gstate4.inflation_pay_factor = inflation_pay_factor;
-      _gstate4.votepay_factor       = votepay_factor;
-      _global4.set( _gstate4, get_self() );
+      _gstate4->inflation_pay_factor = inflation_pay_factor;
+      _gstate4->votepay_factor       = votepay_factor;
+   }
+
+   void system_contract::mergeglobals( bool mirror_legacy ) {
+      require_auth( get_self() );
+
+      if( auto* merged = _gstates.get() ) {
+         const bool restore = mirror_legacy && !merged->mirror_legacy;
+         merged->mirror_legacy = mirror_legacy;
+         if( restore ) {
+            _gstate.restore_legacy( get_self() );
+            _gstate2.restore_legacy( get_self() );
+            _gstate3.restore_legacy( get_self() );
+            _gstate4.restore_legacy( get_self() );
+         }
+      } else {
+         eosio_global_states states;
+         states.mirror_legacy = mirror_legacy;
+         states.global        = *_gstate;
+         states.global2       = *_gstate2;
+         states.global3       = *_gstate3;
+         states.global4       = *_gstate4;
+         _gstates.create( states );
+         _gstate.merged();
+         _gstate2.merged();
+         _gstate3.merged();
+         _gstate4.merged();
+      }
+
+      if( !mirror_legacy ) {
+         _gstate.remove_legacy();
+         _gstate2.remove_legacy();
+         _gstate3.remove_legacy();
+         _gstate4.remove_legacy();
+      }
    }
 
    void system_contract::setschedule( const time_point_sec start_time, double continuous_rate )
@@ -590,8 +629,7 @@ namespace eosiosystem {
       if (itr == _schedules.end()) return false; // no schedules to execute
 
       if ( current_time_point().sec_since_epoch() >= itr->start_time.sec_since_epoch() ) {
-         _gstate4.continuous_rate = itr->continuous_rate;
-         _global4.set( _gstate4, get_self() );
+         _gstate4->continuous_rate = itr->continuous_rate;
          _schedules.erase( itr );
          return true;
       }
@@ -662,7 +700,7 @@ namespace eosiosystem {
 
    void native::setabi( const name& acnt, const std::vector<char>& abi,
                         const binary_extension<std::string>& memo ) {
-      eosio::multi_index< "abihash"_n, abi_hash >  table(get_self(), get_self().value);
+      multi_index< "abihash"_n, abi_hash >  table(get_self(), get_self().value);
       auto itr = table.find( acnt.value );
       if( itr == table.end() ) {
          table.emplace( acnt, [&]( auto& row ) {
@@ -687,10 +725,17 @@ namespace eosiosystem {
       check( system_token_supply.symbol == core, "specified core symbol does not exist (precision mismatch)" );
 
       check( system_token_supply.amount > 0, "system token supply must be greater than 0" );
+
+      // create all global state rows with their defaults
+      _gstate.get();
+      _gstate2.get();
+      _gstate3.get();
+      _gstate4.get();
+
       _rammarket.emplace( get_self(), [&]( auto& m ) {
          m.supply.amount = 100000000000000ll;
          m.supply.symbol = ramcore_symbol;
-         m.base.balance.amount = int64_t(_gstate.free_ram());
+         m.base.balance.amount = int64_t(_gstate->free_ram());
          m.base.balance.symbol = ram_symbol;
          m.quote.balance.amount = system_token_supply.amount / 1000;
          m.quote.balance.symbol = core;
@@ -144,34 +144,40 @@ namespace eosiosystem {
       check(!is_savanna_consensus(), "switchtosvnn can be run only once");
 
       std::vector< finalizer_auth_info > proposed_finalizers;
-      proposed_finalizers.reserve(_gstate.last_producer_schedule_size);
+      proposed_finalizers.reserve(_gstate->last_producer_schedule_size);
 
       // Find a set of producers that meet all the normal requirements for
       // being a proposer and also have an active finalizer key.
       // The number of the producers must be equal to the number of producers
       // in the last_producer_schedule.
-      auto idx = _producers.get_index<"prototalvote"_n>();
-      for( auto it = idx.cbegin(); it != idx.cend() && proposed_finalizers.size() < _gstate.last_producer_schedule_size && 0 < it->total_votes && it->active(); ++it ) {
-         auto finalizer = _finalizers.find( it->owner.value );
+      const auto schedule_size = _gstate->last_producer_schedule_size;
+      visit_top_producers( [&]( const producer_info& prod ) {
+         if( proposed_finalizers.size() >= schedule_size ) {
+            return false;
+         }
+
+         auto finalizer = _finalizers.find( prod.owner.value );
          if( finalizer == _finalizers.end() ) {
             // The producer is not in finalizers table, indicating it does not have an
             // active registered finalizer key. Try next one.
-            continue;
+            return true;
          }
 
          // This should never happen. Double check the finalizer has an active key just in case
          if( finalizer->active_key_binary.empty() ) {
-            continue;
+            return true;
          }
 
          proposed_finalizers.emplace_back(*finalizer);
-      }
+         return proposed_finalizers.size() < schedule_size;
+      });
 
-      check( proposed_finalizers.size() == _gstate.last_producer_schedule_size,
-            "not enough top producers have registered finalizer keys, has " + std::to_string(proposed_finalizers.size()) + ", require " + std::to_string(_gstate.last_producer_schedule_size) );
+      check( proposed_finalizers.size() == _gstate->last_producer_schedule_size,
+            "not enough top producers have registered finalizer keys, has " + std::to_string(proposed_finalizers.size()) + ", require " + std::to_string(_gstate->last_producer_schedule_size) );
 
       set_proposed_finalizers(std::move(proposed_finalizers));
       check( is_savanna_consensus(), "switching to Savanna failed" );
+      invalidate_visited_producers();
    }
 
    /*
@@ -222,6 +228,7 @@ namespace eosiosystem {
             f.active_key_binary    = finalizer_key_itr->finalizer_key_binary;
             f.finalizer_key_count  = 1;
          });
+         invalidate_visited_producers();
       } else {
          // Update finalizer_key_count
          _finalizers.modify( finalizer, same_payer, [&]( auto& f ) {
@@ -260,6 +267,7 @@ namespace eosiosystem {
          f.active_key_id      = finalizer_key_itr->id;
          f.active_key_binary  = finalizer_key_itr->finalizer_key_binary;
       });
+      invalidate_visited_producers();
 
       const auto& last_proposed_finalizers = get_last_proposed_finalizers();
       if( last_proposed_finalizers.empty() ) {
@@ -315,6 +323,7 @@ namespace eosiosystem {
       if( finalizer->finalizer_key_count == 1 ) {
          // The finalizer does not have any registered keys. Remove it from finalizers table.
          _finalizers.erase( finalizer );
+         invalidate_visited_producers();
       } else {
          // Decrement finalizer_key_count finalizers table
          _finalizers.modify( finalizer, same_payer, [&]( auto& f ) {
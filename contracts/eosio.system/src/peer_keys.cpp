@@ -40,64 +40,35 @@ void peer_keys::delpeerkey(const name& proposer_finalizer_name, const public_key
 
 peer_keys::getpeerkeys_res_t peer_keys::getpeerkeys() {
    peer_keys_table  peer_keys_table(get_self(), get_self().value);
-   producers_table  producers(get_self(), get_self().value);
    constexpr size_t max_return = 50;
+   static_assert(max_return <= producer_ranking_size);
 
    getpeerkeys_res_t resp;
    resp.reserve(max_return);
 
    double vote_threshold = 0; // vote_threshold will always be >= 0
 
-   auto add_peer = [&](auto it) {
-      auto peers_itr = peer_keys_table.find(it->owner.value);
+   // 1. Consider both active and non-active producers. as a non-active producer can be
+   //    reactivated at any time. The producer ranking holds both in votes rank order.
+   // 2. Once we have selected 21 producers, the threshold of votes required to be selected
+   //    increases from `> 0` to `> 50% of the votes that the 21st selected producer has`.
+   // --------------------------------------------------------------------------------------
+   for (const auto& prod : read_producer_ranking(get_self())) {
+      if (resp.size() == max_return || prod.total_votes <= vote_threshold)
+         break;
+
+      auto peers_itr = peer_keys_table.find(prod.owner.value);
       if (peers_itr == peer_keys_table.end())
-         resp.push_back(peerkeys_t{it->owner, {}});
+         resp.push_back(peerkeys_t{prod.owner, {}});
       else
-         resp.push_back(peerkeys_t{it->owner, peers_itr->get_public_key()});
+         resp.push_back(peerkeys_t{prod.owner, peers_itr->get_public_key()});
 
       // once 21 producers have been selected, we will only consider producers
       // that have more than 50% of the votes of the 21st selected producer.
       // ---------------------------------------------------------------------
       if (resp.size() == 21)
-         vote_threshold = it->total_votes * 0.5;
-   };
-
-   auto idx = producers.get_index<"prototalvote"_n>();
-
-   auto it  = idx.cbegin();
-   auto rit = idx.cend();
-   if (it == rit)
-      return resp;
-   else
-      --rit;
-
-   // 1. Consider both active and non-active producers. as a non-active producer can be
-   //    reactivated at any time.
-   // 2. Once we have selected 21 producers, the threshold of votes required to be selected
-   //    increases from `> 0` to `> 50% of the votes that the 21st selected producer has`.
-   // 3. We iterate from both ends, as non-active producers are indexed at the end (their
-   //    vote total is negated for the index computation). As a consequence, the highest 
-   //    voted non-active producer will be the last entry of our index.
-   // --------------------------------------------------------------------------------------
-   bool last_one = false;
-   do  {
-      // at this point, `it` and `rit` both point to a valid `producer_info` (possibly the same)
-      assert(it <= rit);
-      assert(vote_threshold >= 0);
-      assert(it->total_votes >= 0 && rit->total_votes >= 0);
-      last_one = (it == rit);
-      if (rit->total_votes > std::max(vote_threshold, it->total_votes)) {
-         add_peer(rit);
-         assert(it != rit); // Should always be satisfied since `rit->total_votes > it->total_votes`
-         --rit;             // safe because `rit` cannot point to the first entry of the index.
-      } else if (it->total_votes > vote_threshold) {
-         add_peer(it);
-         ++it;
-      } else {
-         // `total_votes <= threshold` on both ends of the index, exit the loop.
-         break;
-      }
-   } while (!last_one && resp.size() < max_return);
+         vote_threshold = prod.total_votes * 0.5;
+   }
 
    return resp;
 }
@@ -24,46 +24,52 @@ namespace eosiosystem {
       // Add latest block information to blockinfo table.
       add_to_blockinfo_table(previous_block_id, timestamp);
 
-      // _gstate2.last_block_num is not used anywhere in the system contract code anymore.
+      // _gstate2->last_block_num is not used anywhere in the system contract code anymore.
       // Although this field is deprecated, we will continue updating it for now until the last_block_num field
       // is eventually completely removed, at which point this line can be removed.
-      _gstate2.last_block_num = timestamp;
+      _gstate2->last_block_num = timestamp;
 
       /** until activation, no new rewards are paid */
-      if( _gstate.thresh_activated_stake_time == time_point() )
+      if( _gstate->thresh_activated_stake_time == time_point() )
          return;
 
-      if( _gstate.last_pervote_bucket_fill == time_point() )  /// start the presses
-         _gstate.last_pervote_bucket_fill = current_time_point();
+      if( _gstate->last_pervote_bucket_fill == time_point() )  /// start the presses
+         _gstate->last_pervote_bucket_fill = current_time_point();
 
 
       /**
        * At startup the initial producer may not be one that is registered / elected
        * and therefore there may be no producer object for them.
        */
-      auto prod = _producers.find( producer.value );
-      if ( prod != _producers.end() ) {
-         _gstate.total_unpaid_blocks++;
-         _producers.modify( prod, same_payer, [&](auto& p ) {
-               p.unpaid_blocks++;
+      auto blocks = _producer_blocks.find( producer.value );
+      if ( blocks != _producer_blocks.end() ) {
+         _gstate->total_unpaid_blocks++;
+         _producer_blocks.modify( blocks, same_payer, [&](auto& b ) {
+               b.unpaid_blocks++;
+         });
+      } else if ( _producers.find( producer.value ) != _producers.end() ) {
+         _gstate->total_unpaid_blocks++;
+         _producer_blocks.emplace( get_self(), [&](auto& b ) {
+               b.owner         = producer;
+               b.unpaid_blocks = 1;
          });
       }
 
       /// only update block producers once every minute, block_timestamp is in half seconds
-      if( timestamp.slot - _gstate.last_producer_schedule_update.slot > 120 ) {
+      if( timestamp.slot - _gstate->last_producer_schedule_update.slot > 120 ) {
          update_elected_producers( timestamp );
 
-         if( (timestamp.slot - _gstate.last_name_close.slot) > blocks_per_day ) {
+         if( (timestamp.slot - _gstate->last_name_close.slot) > blocks_per_day ) {
             name_bid_table bids(get_self(), get_self().value);
             auto idx = bids.get_index<"highbid"_n>();
             auto highest = idx.lower_bound( std::numeric_limits<uint64_t>::max()/2 );
             if( highest != idx.end() &&
                 highest->high_bid > 0 &&
                 (current_time_point() - highest->last_bid_time) > microseconds(useconds_per_day) &&
-                _gstate.thresh_activated_stake_time > time_point() &&
-                (current_time_point() - _gstate.thresh_activated_stake_time) > microseconds(14 * useconds_per_day)
+                _gstate->thresh_activated_stake_time > time_point() &&
+                (current_time_point() - _gstate->thresh_activated_stake_time) > microseconds(14 * useconds_per_day)
             ) {
-               _gstate.last_name_close = timestamp;
+               _gstate->last_name_close = timestamp;
                channel_to_system_fees( names_account, asset( highest->high_bid, core_symbol() ) );
 
                // logging
@@ -82,10 +88,11 @@ namespace eosiosystem {
       require_auth( owner );
 
       execute_next_schedule();
+      flush_vote_tally(); // pay out on the current votes
       const auto& prod = _producers.get( owner.value, "producer not registered" );
       check( prod.active(), "producer does not have an active key" );
 
-      check( _gstate.thresh_activated_stake_time != time_point(),
+      check( _gstate->thresh_activated_stake_time != time_point(),
                     "cannot claim rewards until the chain is activated (at least 15% of all tokens participate in voting)" );
 
       const auto ct = current_time_point();
@@ -95,17 +102,17 @@ namespace eosiosystem {
       const asset token_supply   = token::get_supply(token_account, core_symbol().code() );
       const asset token_max_supply = token::get_max_supply(token_account, core_symbol().code() );
       const asset token_balance = token::get_balance(token_account, get_self(), core_symbol().code() );
-      const auto usecs_since_last_fill = (ct - _gstate.last_pervote_bucket_fill).count();
+      const auto usecs_since_last_fill = (ct - _gstate->last_pervote_bucket_fill).count();
 
-      if( usecs_since_last_fill > 0 && _gstate.last_pervote_bucket_fill > time_point() ) {
-         double additional_inflation = (_gstate4.continuous_rate * double(token_supply.amount) * double(usecs_since_last_fill)) / double(useconds_per_year);
+      if( usecs_since_last_fill > 0 && _gstate->last_pervote_bucket_fill > time_point() ) {
+         double additional_inflation = (_gstate4->continuous_rate * double(token_supply.amount) * double(usecs_since_last_fill)) / double(useconds_per_year);
          check( additional_inflation <= double(std::numeric_limits<int64_t>::max() - ((1ll << 10) - 1)),
                 "overflow in calculating new tokens to be issued; inflation rate is too high" );
          int64_t new_tokens = (additional_inflation < 0.0) ? 0 : static_cast<int64_t>(additional_inflation);
 
-         int64_t to_producers     = (new_tokens * uint128_t(pay_factor_precision)) / _gstate4.inflation_pay_factor;
+         int64_t to_producers     = (new_tokens * uint128_t(pay_factor_precision)) / _gstate4->inflation_pay_factor;
          int64_t to_savings       = new_tokens - to_producers;
-         int64_t to_per_block_pay = (to_producers * uint128_t(pay_factor_precision)) / _gstate4.votepay_factor;
+         int64_t to_per_block_pay = (to_producers * uint128_t(pay_factor_precision)) / _gstate4->votepay_factor;
          int64_t to_per_vote_pay  = to_producers - to_per_block_pay;
 
          if( new_tokens > 0 ) {
@@ -135,9 +142,9 @@ namespace eosiosystem {
             }
          }
 
-         _gstate.pervote_bucket          += to_per_vote_pay;
-         _gstate.perblock_bucket         += to_per_block_pay;
-         _gstate.last_pervote_bucket_fill = ct;
+         _gstate->pervote_bucket          += to_per_vote_pay;
+         _gstate->perblock_bucket         += to_per_block_pay;
+         _gstate->last_pervote_bucket_fill = ct;
       }
 
       auto prod2 = _producers2.find( owner.value );
@@ -162,9 +169,12 @@ namespace eosiosystem {
       // This is okay because in this case the producer will not get paid anything either way.
       // In fact it is desired behavior because the producers votes need to be counted in the global total_producer_votepay_share for the first time.
 
+      auto blocks = _producer_blocks.find( owner.value );
+      const uint32_t unpaid_blocks = prod.unpaid_blocks + (blocks != _producer_blocks.end() ? blocks->unpaid_blocks : 0);
+
       int64_t producer_per_block_pay = 0;
-      if( _gstate.total_unpaid_blocks > 0 ) {
-         producer_per_block_pay = (_gstate.perblock_bucket * prod.unpaid_blocks) / _gstate.total_unpaid_blocks;
+      if( _gstate->total_unpaid_blocks > 0 ) {
+         producer_per_block_pay = (_gstate->perblock_bucket * unpaid_blocks) / _gstate->total_unpaid_blocks;
       }
 
       double new_votepay_share = update_producer_votepay_share( prod2,
@@ -174,16 +184,16 @@ namespace eosiosystem {
                                  );
 
       int64_t producer_per_vote_pay = 0;
-      if( _gstate2.revision > 0 ) {
+      if( _gstate2->revision > 0 ) {
          double total_votepay_share = update_total_votepay_share( ct );
          if( total_votepay_share > 0 && !crossed_threshold ) {
-            producer_per_vote_pay = int64_t((new_votepay_share * _gstate.pervote_bucket) / total_votepay_share);
-            if( producer_per_vote_pay > _gstate.pervote_bucket )
-               producer_per_vote_pay = _gstate.pervote_bucket;
+            producer_per_vote_pay = int64_t((new_votepay_share * _gstate->pervote_bucket) / total_votepay_share);
+            if( producer_per_vote_pay > _gstate->pervote_bucket )
+               producer_per_vote_pay = _gstate->pervote_bucket;
          }
       } else {
-         if( _gstate.total_producer_vote_weight > 0 ) {
-            producer_per_vote_pay = int64_t((_gstate.pervote_bucket * prod.total_votes) / _gstate.total_producer_vote_weight);
+         if( _gstate->total_producer_vote_weight > 0 ) {
+            producer_per_vote_pay = int64_t((_gstate->pervote_bucket * prod.total_votes) / _gstate->total_producer_vote_weight);
          }
       }
 
@@ -191,9 +201,9 @@ namespace eosiosystem {
          producer_per_vote_pay = 0;
       }
 
-      _gstate.pervote_bucket      -= producer_per_vote_pay;
-      _gstate.perblock_bucket     -= producer_per_block_pay;
-      _gstate.total_unpaid_blocks -= prod.unpaid_blocks;
+      _gstate->pervote_bucket      -= producer_per_vote_pay;
+      _gstate->perblock_bucket     -= producer_per_block_pay;
+      _gstate->total_unpaid_blocks -= unpaid_blocks;
 
       update_total_votepay_share( ct, -new_votepay_share, (updated_after_threshold ? prod.total_votes : 0.0) );
 
@@ -201,6 +211,11 @@ namespace eosiosystem {
          p.last_claim_time = ct;
          p.unpaid_blocks   = 0;
       });
+      if( blocks != _producer_blocks.end() && blocks->unpaid_blocks > 0 ) {
+         _producer_blocks.modify( blocks, same_payer, [&](auto& b) {
+            b.unpaid_blocks = 0;
+         });
+      }
 
       if ( producer_per_block_pay > 0 ) {
          token::transfer_action transfer_act{ token_account, { {bpay_account, active_permission}, {owner, active_permission} } };
@@ -23,6 +23,16 @@ namespace eosiosystem {
       _rexmaturity.set(state, get_self());
    }
 
+   void system_contract::cfgrexresult( bool aggregate )
+   {
+      require_auth( get_self() );
+
+      rex_result_config_singleton config( get_self(), get_self().value );
+      auto state = config.get_or_default();
+      state.aggregate_orders = aggregate;
+      config.set( state, get_self() );
+   }
+
    void system_contract::deposit( const name& owner, const asset& amount )
    {
       require_auth( owner );
@@ -105,7 +115,7 @@ namespace eosiosystem {
       const asset rex_received = add_to_rex_pool( payment );
       auto rex_stake_delta = add_to_rex_balance( owner, payment, rex_received );
       runrex(2);
-      update_rex_account( owner, asset( 0, core_symbol() ), rex_stake_delta - payment, true );
+      update_rex_account( owner, asset( 0, core_symbol() ), rex_stake_delta - payment, true, -payment.amount );
 
       process_buy_rex_to_savings( owner, rex_received );
       process_sell_matured_rex( owner );
@@ -129,10 +139,12 @@ namespace eosiosystem {
       auto bitr = _rexbalance.require_find( from.value, "user must first buyrex" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol,
              "asset must be a positive amount of (REX, 4)" );
-      process_rex_maturities( bitr );
-      check( rex.amount <= bitr->matured_rex, "insufficient available rex" );
+      rex_balance rb = *bitr;
+      process_rex_maturities( rb );
+      check( rex.amount <= rb.matured_rex, "insufficient available rex" );
 
-      const auto current_order = fill_rex_order( bitr, rex );
+      const auto current_order = fill_rex_order( rb, rex );
+      store_rex_balance( bitr, rb );
       if ( current_order.success && current_order.proceeds.amount == 0 ) {
          check( false, "proceeds are negligible" );
       }
@@ -162,7 +174,7 @@ namespace eosiosystem {
          }
          pending_sell_order.amount = oitr->rex_requested.amount;
       }
-      check( pending_sell_order.amount <= bitr->matured_rex, "insufficient funds for current and scheduled orders" );
+      check( pending_sell_order.amount <= rb.matured_rex, "insufficient funds for current and scheduled orders" );
       // dummy action added so that sell order proceeds show up in action trace
       if ( current_order.success ) {
          rex_results::sellresult_action sellrex_act( rex_account, std::vector<eosio::permission_level>{ } );
@@ -233,6 +245,21 @@ namespace eosiosystem {
    {
       require_auth( owner );
 
+      update_rex_account( owner, asset( 0, core_symbol() ), refresh_rex_vote_stake( owner ), true );
+   }
+
+   /**
+    * @brief Brings the vote stake of owner REX balance up to date with the REX pool
+    *
+    * Processes queued REX orders and matured REX of owner, and recomputes the vote stake of its REX balance.
+    * The vote weight of owner is not updated.
+    *
+    * @param owner - owner account name
+    *
+    * @return asset - change of the vote stake
+    */
+   asset system_contract::refresh_rex_vote_stake( const name& owner )
+   {
       runrex(2);
 
       auto itr = _rexbalance.require_find( owner.value, "account has no REX balance" );
@@ -249,10 +276,10 @@ namespace eosiosystem {
       }
       _rexbalance.modify( itr, same_payer, [&]( auto& rb ) {
          rb.vote_stake = current_stake;
+         process_rex_maturities( rb );
       });
 
-      update_rex_account( owner, asset( 0, core_symbol() ), current_stake - init_stake, true );
-      process_rex_maturities( itr );
+      return current_stake - init_stake;
    }
 
    void system_contract::setrex( const asset& balance )
@@ -294,29 +321,29 @@ namespace eosiosystem {
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
       const asset   rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
-      const int64_t rex_in_savings    = read_rex_savings( bitr );
-      check( rex.amount + rex_in_sell_order.amount + rex_in_savings <= bitr->rex_balance.amount,
+      rex_balance   rb                = *bitr;
+      const int64_t rex_in_savings    = read_rex_savings( rb );
+      check( rex.amount + rex_in_sell_order.amount + rex_in_savings <= rb.rex_balance.amount,
              "insufficient REX balance" );
-      process_rex_maturities( bitr );
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         int64_t moved_rex = 0;
-         while ( !rb.rex_maturities.empty() && moved_rex < rex.amount) {
-            const int64_t d_rex = std::min( rex.amount - moved_rex, rb.rex_maturities.back().second );
-            rb.rex_maturities.back().second -= d_rex;
-            moved_rex                       += d_rex;
-            if ( rb.rex_maturities.back().second == 0 ) {
-               rb.rex_maturities.pop_back();
-            }
-         }
-         if ( moved_rex < rex.amount ) {
-            const int64_t d_rex = rex.amount - moved_rex;
-            rb.matured_rex    -= d_rex;
-            moved_rex         += d_rex;
-            check( rex_in_sell_order.amount <= rb.matured_rex, "logic error in mvtosavings" );
+      process_rex_maturities( rb );
+      int64_t moved_rex = 0;
+      while ( !rb.rex_maturities.empty() && moved_rex < rex.amount) {
+         const int64_t d_rex = std::min( rex.amount - moved_rex, rb.rex_maturities.back().second );
+         rb.rex_maturities.back().second -= d_rex;
+         moved_rex                       += d_rex;
+         if ( rb.rex_maturities.back().second == 0 ) {
+            rb.rex_maturities.pop_back();
          }
-         check( moved_rex == rex.amount, "programmer error in mvtosavings" );
-      });
-      put_rex_savings( bitr, rex_in_savings + rex.amount );
+      }
+      if ( moved_rex < rex.amount ) {
+         const int64_t d_rex = rex.amount - moved_rex;
+         rb.matured_rex    -= d_rex;
+         moved_rex         += d_rex;
+         check( rex_in_sell_order.amount <= rb.matured_rex, "logic error in mvtosavings" );
+      }
+      check( moved_rex == rex.amount, "programmer error in mvtosavings" );
+      put_rex_savings( rb, rex_in_savings + rex.amount );
+      store_rex_balance( bitr, rb );
    }
 
    void system_contract::mvfrsavings( const name& owner, const asset& rex )
@@ -327,18 +354,18 @@ namespace eosiosystem {
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
-      const int64_t rex_in_savings = read_rex_savings( bitr );
+      rex_balance   rb             = *bitr;
+      const int64_t rex_in_savings = read_rex_savings( rb );
       check( rex.amount <= rex_in_savings, "insufficient REX in savings" );
-      process_rex_maturities( bitr );
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex.amount;
-         } else {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64 { maturity, rex.amount } );
-         }
-      });
-      put_rex_savings( bitr, rex_in_savings - rex.amount );
+      process_rex_maturities( rb );
+      const time_point_sec maturity = get_rex_maturity();
+      if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
+         rb.rex_maturities.back().second += rex.amount;
+      } else {
+         rb.rex_maturities.emplace_back( pair_time_point_sec_int64 { maturity, rex.amount } );
+      }
+      put_rex_savings( rb, rex_in_savings - rex.amount );
+      store_rex_balance( bitr, rb );
       update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
    }
 
@@ -399,6 +426,75 @@ namespace eosiosystem {
       transfer_act.send( payer, rex_account, quantity, memo );
    }
 
+   rex_quote system_contract::rexquote( const name& owner, const asset& payment, const asset& rex, const asset& loan_payment )
+   {
+      check( payment.symbol == core_symbol() && loan_payment.symbol == core_symbol(), "payment must be core token" );
+      check( rex.symbol == rex_symbol, "rex must be (REX, 4)" );
+      check( 0 <= payment.amount && 0 <= rex.amount && 0 <= loan_payment.amount, "must use non-negative amounts" );
+      check( rex_system_initialized(), "rex system not initialized yet" );
+
+      rex_quote quote{ asset( 0, rex_symbol ), asset( 0, core_symbol() ), false, asset( 0, rex_symbol ), asset( 0, core_symbol() ) };
+
+      // the pool as the next REX action sees it once update_rex_pool has run
+      rex_pool pool = *_rexpool.begin();
+      const auto ret_pool_elem = _rexretpool.begin();
+      if ( ret_pool_elem != _rexretpool.end() ) {
+         rex_return_pool                   rp = *ret_pool_elem;
+         std::optional<rex_return_buckets> buckets;
+         const int64_t change_estimate = advance_rex_return_pool( rp, buckets );
+         if ( change_estimate > 0 ) {
+            pool.total_unlent.amount += change_estimate;
+            pool.total_lendable       = pool.total_unlent + pool.total_lent;
+         }
+      }
+
+      // same as add_to_rex_pool
+      if ( payment.amount > 0 ) {
+         const int64_t rex_ratio = 10000;
+         if ( pool.total_rex.amount <= 0 ) {
+            quote.rex_received.amount = payment.amount * rex_ratio;
+         } else if ( pool.total_lendable.amount > 0 ) {
+            const int64_t S0 = pool.total_lendable.amount;
+            const int64_t R0 = pool.total_rex.amount;
+            quote.rex_received.amount = (uint128_t(S0 + payment.amount) * R0) / S0 - R0;
+         }
+      }
+
+      // same as fill_rex_order
+      if ( rex.amount > 0 && pool.total_rex.amount > 0 ) {
+         const int64_t S0 = pool.total_lendable.amount;
+         const int64_t R0 = pool.total_rex.amount;
+         quote.proceeds.amount = (uint128_t(rex.amount) * S0) / R0;
+         quote.sell_fills      = quote.proceeds.amount <= pool.total_unlent.amount - pool.total_lent.amount / 10;
+      }
+
+      // same as sell_rex, after process_rex_maturities
+      if ( owner ) {
+         const auto bitr = _rexbalance.find( owner.value );
+         if ( bitr != _rexbalance.end() ) {
+            rex_balance rb = *bitr;
+            process_rex_maturities( rb );
+            quote.sellable_rex.amount = rb.matured_rex;
+            const auto oitr = _rexorders.find( owner.value );
+            if ( oitr != _rexorders.end() && oitr->is_open ) {
+               quote.sellable_rex.amount = std::max( int64_t(0), quote.sellable_rex.amount - oitr->rex_requested.amount );
+            }
+         }
+      }
+
+      // same as rent_rex
+      if ( loan_payment.amount > 0 && rex_loans_available() ) {
+         const int64_t rented_tokens = exchange_state::get_bancor_output( pool.total_rent.amount,
+                                                                          pool.total_unlent.amount,
+                                                                          loan_payment.amount );
+         if ( loan_payment.amount < rented_tokens ) {
+            quote.rented_tokens.amount = rented_tokens;
+         }
+      }
+
+      return quote;
+   }
+
    /**
     * @brief Updates account NET and CPU resource limits
     *
@@ -617,27 +713,41 @@ namespace eosiosystem {
       if ( _rexorders.begin() != _rexorders.end() ) {
          auto idx  = _rexorders.get_index<"bytime"_n>();
          auto oitr = idx.begin();
+         std::vector<order_result> filled;
+         rex_result_config_singleton config( get_self(), get_self().value );
+         const bool aggregate = config.get_or_default().aggregate_orders;
          for ( uint16_t i = 0; i < max; ++i ) {
             if ( oitr == idx.end() || !oitr->is_open ) break;
             auto next = oitr;
             ++next;
             auto bitr = _rexbalance.find( oitr->owner.value );
             if ( bitr != _rexbalance.end() ) { // should always be true
-               auto result = fill_rex_order( bitr, oitr->rex_requested );
+               rex_balance rb = *bitr;
+               auto result = fill_rex_order( rb, oitr->rex_requested );
                if ( result.success ) {
+                  store_rex_balance( bitr, rb );
                   const name order_owner = oitr->owner;
                   idx.modify( oitr, same_payer, [&]( auto& order ) {
                      order.proceeds.amount     = result.proceeds.amount;
                      order.stake_change.amount = result.stake_change.amount;
                      order.close();
                   });
-                  /// send dummy action to show owner and proceeds of filled sellrex order
-                  rex_results::orderresult_action order_act( rex_account, std::vector<eosio::permission_level>{ } );
-                  order_act.send( order_owner, result.proceeds );
+                  if ( aggregate ) {
+                     filled.push_back( order_result{ order_owner, result.proceeds } );
+                  } else {
+                     /// send dummy action to show owner and proceeds of filled sellrex order
+                     rex_results::orderresult_action order_act( rex_account, std::vector<eosio::permission_level>{ } );
+                     order_act.send( order_owner, result.proceeds );
+                  }
                }
             }
             oitr = next;
          }
+         if ( !filled.empty() ) {
+            /// send dummy action to show owners and proceeds of the sellrex orders filled by this batch
+            rex_results::orderresults_action orders_act( rex_account, std::vector<eosio::permission_level>{ } );
+            orders_act.send( filled );
+         }
       }
 
    }
@@ -646,106 +756,131 @@ namespace eosiosystem {
     * @brief Adds returns from the REX return pool to the REX pool
     */
    void system_contract::update_rex_pool()
+   {
+      const auto ret_pool_elem = _rexretpool.begin();
+      if ( ret_pool_elem == _rexretpool.end() ) {
+         return;
+      }
+
+      rex_return_pool                   rp = *ret_pool_elem;
+      std::optional<rex_return_buckets> buckets;
+      const int64_t change_estimate = advance_rex_return_pool( rp, buckets );
+      if ( rp.last_dist_time == ret_pool_elem->last_dist_time ) {
+         return;
+      }
+
+      _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& r ) {
+         r = rp;
+      });
+      if ( buckets.has_value() ) {
+         _rexretbuckets.modify( _rexretbuckets.begin(), same_payer, [&]( auto& b ) {
+            b = *buckets;
+         });
+      }
+      if ( change_estimate > 0 ) {
+         _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& pool ) {
+            pool.total_unlent.amount += change_estimate;
+            pool.total_lendable       = pool.total_unlent + pool.total_lent;
+         });
+      }
+   }
+
+   /**
+    * @brief Advances copies of the REX return pool rows to the current time without writing them
+    *
+    * Used by update_rex_pool and, to quote against the state the next REX action sees, by rexquote. The cost does
+    * not depend on how long ago the pool was last updated: the distribution since then is the current rate times
+    * the number of elapsed intervals, and the surplus of expired buckets follows from the time each of them expired.
+    * The expiry loop is bounded by the number of buckets in the 30-day window, at most one per 12 hours.
+    *
+    * @param rp - copy of the return pool row, updated in place
+    * @param buckets - copy of the return buckets row, only read when a bucket is added or expires
+    *
+    * @return int64_t - amount of core tokens to add to the REX pool
+    */
+   int64_t system_contract::advance_rex_return_pool( rex_return_pool& rp, std::optional<rex_return_buckets>& buckets )
    {
       auto get_elapsed_intervals = [&]( const time_point_sec& t1, const time_point_sec& t0 ) -> uint32_t {
          return ( t1.sec_since_epoch() - t0.sec_since_epoch() ) / rex_return_pool::dist_interval;
       };
+      auto return_buckets = [&]() -> std::vector<pair_time_point_sec_int64>& {
+         if ( !buckets.has_value() ) {
+            buckets = *_rexretbuckets.begin();
+         }
+         return buckets->return_buckets;
+      };
 
       const time_point_sec ct             = current_time_point();
       const uint32_t       cts            = ct.sec_since_epoch();
       const time_point_sec effective_time{cts - cts % rex_return_pool::dist_interval};
 
-      const auto ret_pool_elem    = _rexretpool.begin();
-      const auto ret_buckets_elem = _rexretbuckets.begin();
-
-      if ( ret_pool_elem == _rexretpool.end() || effective_time <= ret_pool_elem->last_dist_time ) {
-         return;
+      if ( effective_time <= rp.last_dist_time ) {
+         return 0;
       }
 
-      const int64_t  current_rate      = ret_pool_elem->current_rate_of_increase;
-      const uint32_t elapsed_intervals = get_elapsed_intervals( effective_time, ret_pool_elem->last_dist_time );
+      const int64_t  current_rate      = rp.current_rate_of_increase;
+      const uint32_t elapsed_intervals = get_elapsed_intervals( effective_time, rp.last_dist_time );
       int64_t        change_estimate   = current_rate * elapsed_intervals;
 
-      {
-         const bool new_return_bucket = ret_pool_elem->pending_bucket_time <= effective_time;
-         int64_t        new_bucket_rate = 0;
-         time_point_sec new_bucket_time = time_point_sec::min();
-         _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& rp ) {
-            if ( new_return_bucket ) {
-               int64_t remainder = rp.pending_bucket_proceeds % rex_return_pool::total_intervals;
-               new_bucket_rate   = ( rp.pending_bucket_proceeds - remainder ) / rex_return_pool::total_intervals;
-               new_bucket_time   = rp.pending_bucket_time;
-               rp.current_rate_of_increase += new_bucket_rate;
-               change_estimate             += remainder + new_bucket_rate * get_elapsed_intervals( effective_time, rp.pending_bucket_time );
-               rp.pending_bucket_proceeds   = 0;
-               rp.pending_bucket_time       = time_point_sec::maximum();
-               if ( new_bucket_time < rp.oldest_bucket_time ) {
-                  rp.oldest_bucket_time = new_bucket_time;
-               }
-            }
-            rp.proceeds      -= change_estimate;
-            rp.last_dist_time = effective_time;
-         });
+      if ( rp.pending_bucket_time <= effective_time ) {
+         int64_t remainder = rp.pending_bucket_proceeds % rex_return_pool::total_intervals;
+         const int64_t        new_bucket_rate = ( rp.pending_bucket_proceeds - remainder ) / rex_return_pool::total_intervals;
+         const time_point_sec new_bucket_time = rp.pending_bucket_time;
+         rp.current_rate_of_increase += new_bucket_rate;
+         change_estimate             += remainder + new_bucket_rate * get_elapsed_intervals( effective_time, rp.pending_bucket_time );
+         rp.pending_bucket_proceeds   = 0;
+         rp.pending_bucket_time       = time_point_sec::maximum();
+         if ( new_bucket_time < rp.oldest_bucket_time ) {
+            rp.oldest_bucket_time = new_bucket_time;
+         }
 
-         if ( new_return_bucket ) {
-            _rexretbuckets.modify( ret_buckets_elem, same_payer, [&]( auto& rb ) {
-               auto iter = std::lower_bound(rb.return_buckets.begin(), rb.return_buckets.end(), new_bucket_time, [](const pair_time_point_sec_int64& bucket, time_point_sec first) {
-                  return bucket.first < first;
-               });
-               if ((iter != rb.return_buckets.end()) && (iter->first == new_bucket_time)) {
-                  iter->second = new_bucket_rate;
-               } else {
-                  rb.return_buckets.insert(iter, pair_time_point_sec_int64{new_bucket_time, new_bucket_rate});
-               }
+         // buckets mature in order, so the new bucket is almost always appended
+         auto& rb = return_buckets();
+         if ( rb.empty() || rb.back().first < new_bucket_time ) {
+            rb.push_back( pair_time_point_sec_int64{new_bucket_time, new_bucket_rate} );
+         } else {
+            auto iter = std::lower_bound(rb.begin(), rb.end(), new_bucket_time, [](const pair_time_point_sec_int64& bucket, time_point_sec first) {
+               return bucket.first < first;
             });
+            if ((iter != rb.end()) && (iter->first == new_bucket_time)) {
+               iter->second = new_bucket_rate;
+            } else {
+               rb.insert(iter, pair_time_point_sec_int64{new_bucket_time, new_bucket_rate});
+            }
          }
       }
+      rp.proceeds      -= change_estimate;
+      rp.last_dist_time = effective_time;
 
       const time_point_sec time_threshold = effective_time - seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval);
-      if ( ret_pool_elem->oldest_bucket_time <= time_threshold ) {
+      if ( rp.oldest_bucket_time <= time_threshold ) {
          int64_t expired_rate = 0;
          int64_t surplus      = 0;
-         _rexretbuckets.modify( ret_buckets_elem, same_payer, [&]( auto& rb ) {
-            auto& return_buckets = rb.return_buckets;
-            auto iter = return_buckets.begin();
-            for (; iter != return_buckets.end() && iter->first <= time_threshold; ++iter) {
-               const uint32_t overtime = get_elapsed_intervals( effective_time,
-                                                                iter->first + seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval) );
-               surplus      += iter->second * overtime;
-               expired_rate += iter->second;
-            }
-            return_buckets.erase(return_buckets.begin(), iter);
-         });
-
-         _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& rp ) {
-            if ( !ret_buckets_elem->return_buckets.empty() ) {
-               rp.oldest_bucket_time = ret_buckets_elem->return_buckets.begin()->first;
-            } else {
-               rp.oldest_bucket_time = time_point_sec::min();
-            }
-            if ( expired_rate > 0) {
-               rp.current_rate_of_increase -= expired_rate;
-            }
-            if ( surplus > 0 ) {
-               change_estimate -= surplus;
-               rp.proceeds     += surplus;
-            }
-         });
-      }
+         auto& rb   = return_buckets();
+         auto  iter = rb.begin();
+         for (; iter != rb.end() && iter->first <= time_threshold; ++iter) {
+            const uint32_t overtime = get_elapsed_intervals( effective_time,
+                                                             iter->first + seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval) );
+            surplus      += iter->second * overtime;
+            expired_rate += iter->second;
+         }
+         rb.erase(rb.begin(), iter);
 
-      if ( change_estimate > 0 && ret_pool_elem->proceeds < 0 ) {
-         _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& rp ) {
-            change_estimate += rp.proceeds;
-            rp.proceeds      = 0;
-         });
+         rp.oldest_bucket_time = rb.empty() ? time_point_sec::min() : rb.begin()->first;
+         if ( expired_rate > 0) {
+            rp.current_rate_of_increase -= expired_rate;
+         }
+         if ( surplus > 0 ) {
+            change_estimate -= surplus;
+            rp.proceeds     += surplus;
+         }
       }
 
-      if ( change_estimate > 0 ) {
-         _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& pool ) {
-            pool.total_unlent.amount += change_estimate;
-            pool.total_lendable       = pool.total_unlent + pool.total_lent;
-         });
+      if ( change_estimate > 0 && rp.proceeds < 0 ) {
+         change_estimate += rp.proceeds;
+         rp.proceeds      = 0;
       }
+      return change_estimate;
    }
 
    template <typename T>
@@ -796,13 +931,13 @@ namespace eosiosystem {
     * different function to complete order processing, i.e. transfer proceeds to user REX fund and
     * update user vote weight.
     *
-    * @param bitr - iterator pointing to rex_balance database record
+    * @param rb - working copy of the owner rex_balance record, the caller writes it back with store_rex_balance
     * @param rex - amount of rex to be sold
     *
     * @return rex_order_outcome - a struct containing success flag, order proceeds, and resultant
     * vote stake change
     */
-   rex_order_outcome system_contract::fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex )
+   rex_order_outcome system_contract::fill_rex_order( rex_balance& rb, const asset& rex )
    {
       auto rexpool_itr = _rexpool.begin();
       const int64_t S0 = rexpool_itr->total_lendable.amount;
@@ -817,19 +952,17 @@ namespace eosiosystem {
       const int64_t unlent_lower_bound = rexpool_itr->total_lent.amount / 10;
       const int64_t available_unlent   = rexpool_itr->total_unlent.amount - unlent_lower_bound; // available_unlent <= 0 is possible
       if ( proceeds.amount <= available_unlent ) {
-         const int64_t init_vote_stake_amount = bitr->vote_stake.amount;
-         const int64_t current_stake_value    = ( uint128_t(bitr->rex_balance.amount) * S0 ) / R0;
+         const int64_t init_vote_stake_amount = rb.vote_stake.amount;
+         const int64_t current_stake_value    = ( uint128_t(rb.rex_balance.amount) * S0 ) / R0;
          _rexpool.modify( rexpool_itr, same_payer, [&]( auto& rt ) {
             rt.total_rex.amount      = R1;
             rt.total_lendable.amount = S1;
             rt.total_unlent.amount   = rt.total_lendable.amount - rt.total_lent.amount;
          });
-         _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-            rb.vote_stake.amount   = current_stake_value - proceeds.amount;
-            rb.rex_balance.amount -= rex.amount;
-            rb.matured_rex        -= rex.amount;
-         });
-         stake_change.amount = bitr->vote_stake.amount - init_vote_stake_amount;
+         rb.vote_stake.amount   = current_stake_value - proceeds.amount;
+         rb.rex_balance.amount -= rex.amount;
+         rb.matured_rex        -= rex.amount;
+         stake_change.amount = rb.vote_stake.amount - init_vote_stake_amount;
          success = true;
       } else {
          proceeds.amount = 0;
@@ -917,29 +1050,50 @@ namespace eosiosystem {
     * @param proceeds - additional proceeds to be transferred to owner REX fund
     * @param delta_stake - additional stake to be added to owner vote weight
     * @param force_vote_update - if true, vote weight is updated even if vote stake didn't change
+    * @param delegated_stake_delta - change of owner delegated stake total, written with the vote weight update
     *
     * @return asset - REX amount of owner unfilled sell order if one exists
     */
-   asset system_contract::update_rex_account( const name& owner, const asset& proceeds, const asset& delta_stake, bool force_vote_update )
+   asset system_contract::update_rex_account( const name& owner, const asset& proceeds, const asset& delta_stake, bool force_vote_update,
+                                              int64_t delegated_stake_delta )
    {
-      asset to_fund( proceeds );
       asset to_stake( delta_stake );
+      const asset rex_in_sell_order = settle_rex_order( owner, proceeds, to_stake );
+      if ( force_vote_update || to_stake.amount != 0 )
+         update_voting_power( owner, to_stake, delegated_stake_delta );
+
+      return rex_in_sell_order;
+   }
+
+   /**
+    * @brief Completes owner filled sellrex order without updating vote weight
+    *
+    * Transfers the order proceeds and `proceeds` to owner REX fund, adds the order stake change
+    * to `stake_change`, and deletes the order.
+    *
+    * @param owner - owner account name
+    * @param proceeds - additional proceeds to be transferred to owner REX fund
+    * @param stake_change - vote stake change of owner, the order stake change is added to it
+    *
+    * @return asset - REX amount of owner unfilled sell order if one exists
+    */
+   asset system_contract::settle_rex_order( const name& owner, const asset& proceeds, asset& stake_change )
+   {
+      asset to_fund( proceeds );
       asset rex_in_sell_order( 0, rex_symbol );
       auto itr = _rexorders.find( owner.value );
       if ( itr != _rexorders.end() ) {
          if ( itr->is_open ) {
             rex_in_sell_order.amount = itr->rex_requested.amount;
          } else {
-            to_fund.amount  += itr->proceeds.amount;
-            to_stake.amount += itr->stake_change.amount;
+            to_fund.amount       += itr->proceeds.amount;
+            stake_change.amount  += itr->stake_change.amount;
             _rexorders.erase( itr );
          }
       }
 
       if ( to_fund.amount > 0 )
          transfer_to_fund( owner, to_fund );
-      if ( force_vote_update || to_stake.amount != 0 )
-         update_voting_power( owner, to_stake );
 
       return rex_in_sell_order;
    }
@@ -963,17 +1117,16 @@ namespace eosiosystem {
    /**
     * @brief Updates REX owner maturity buckets
     *
-    * @param bitr - iterator pointing to rex_balance object
+    * @param rb - working copy of the owner rex_balance object
     */
-   void system_contract::process_rex_maturities( const rex_balance_table::const_iterator& bitr )
+   void system_contract::process_rex_maturities( rex_balance& rb )
    {
       const time_point_sec now = current_time_point();
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         while ( !rb.rex_maturities.empty() && rb.rex_maturities.front().first <= now ) {
-            rb.matured_rex += rb.rex_maturities.front().second;
-            rb.rex_maturities.erase(rb.rex_maturities.begin());
-         }
-      });
+      auto itr = rb.rex_maturities.begin();
+      for ( ; itr != rb.rex_maturities.end() && itr->first <= now; ++itr ) {
+         rb.matured_rex += itr->second;
+      }
+      rb.rex_maturities.erase( rb.rex_maturities.begin(), itr );
    }
 
    /**
@@ -1017,19 +1170,19 @@ namespace eosiosystem {
    void system_contract::consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                                   const asset& rex_in_sell_order )
    {
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         int64_t total  = rb.matured_rex - rex_in_sell_order.amount;
-         rb.matured_rex = rex_in_sell_order.amount;
-         while ( !rb.rex_maturities.empty() ) {
-            total += rb.rex_maturities.front().second;
-            rb.rex_maturities.erase(rb.rex_maturities.begin());
-         }
-         if ( total > 0 ) {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64{ get_rex_maturity(), total } );
-         }
-      });
-      put_rex_savings( bitr, rex_in_savings );
+      rex_balance   rb             = *bitr;
+      const int64_t rex_in_savings = read_rex_savings( rb );
+      int64_t total  = rb.matured_rex - rex_in_sell_order.amount;
+      rb.matured_rex = rex_in_sell_order.amount;
+      for ( const auto& maturity : rb.rex_maturities ) {
+         total += maturity.second;
+      }
+      rb.rex_maturities.clear();
+      if ( total > 0 ) {
+         rb.rex_maturities.emplace_back( pair_time_point_sec_int64{ get_rex_maturity(), total } );
+      }
+      put_rex_savings( rb, rex_in_savings );
+      store_rex_balance( bitr, rb );
    }
 
    /**
@@ -1141,35 +1294,39 @@ namespace eosiosystem {
    {
       asset init_rex_stake( 0, core_symbol() );
       asset current_rex_stake( 0, core_symbol() );
+      rex_balance rb;
       auto bitr = _rexbalance.find( owner.value );
       if ( bitr == _rexbalance.end() ) {
-         bitr = _rexbalance.emplace( owner, [&]( auto& rb ) {
-            rb.owner       = owner;
-            rb.vote_stake  = payment;
-            rb.rex_balance = rex_received;
-         });
+         rb.owner       = owner;
+         rb.vote_stake  = payment;
+         rb.rex_balance = rex_received;
          current_rex_stake.amount = payment.amount;
       } else {
-         init_rex_stake.amount = bitr->vote_stake.amount;
-         _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-            rb.rex_balance.amount += rex_received.amount;
-            rb.vote_stake.amount   = ( uint128_t(rb.rex_balance.amount) * _rexpool.begin()->total_lendable.amount )
-                                     / _rexpool.begin()->total_rex.amount;
-         });
-         current_rex_stake.amount = bitr->vote_stake.amount;
+         rb = *bitr;
+         init_rex_stake.amount  = rb.vote_stake.amount;
+         rb.rex_balance.amount += rex_received.amount;
+         rb.vote_stake.amount   = ( uint128_t(rb.rex_balance.amount) * _rexpool.begin()->total_lendable.amount )
+                                  / _rexpool.begin()->total_rex.amount;
+         current_rex_stake.amount = rb.vote_stake.amount;
       }
 
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      process_rex_maturities( bitr );
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex_received.amount;
-         } else {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64 { maturity, rex_received.amount } );
-         }
-      });
-      put_rex_savings( bitr, rex_in_savings );
+      const int64_t rex_in_savings = read_rex_savings( rb );
+      process_rex_maturities( rb );
+      const time_point_sec maturity = get_rex_maturity();
+      if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
+         rb.rex_maturities.back().second += rex_received.amount;
+      } else {
+         rb.rex_maturities.emplace_back( pair_time_point_sec_int64 { maturity, rex_received.amount } );
+      }
+      put_rex_savings( rb, rex_in_savings );
+
+      if ( bitr == _rexbalance.end() ) {
+         _rexbalance.emplace( owner, [&]( auto& b ) {
+            b = rb;
+         });
+      } else {
+         store_rex_balance( bitr, rb );
+      }
       return current_rex_stake - init_rex_stake;
    }
 
@@ -1180,19 +1337,17 @@ namespace eosiosystem {
     * allow uniform processing of remaining buckets as savings is a special case. This
     * function is used in conjunction with put_rex_savings.
     *
-    * @param bitr - iterator pointing to rex_balance object
+    * @param rb - working copy of the owner rex_balance object
     *
     * @return int64_t - amount of REX in savings bucket
     */
-   int64_t system_contract::read_rex_savings( const rex_balance_table::const_iterator& bitr )
+   int64_t system_contract::read_rex_savings( rex_balance& rb )
    {
       int64_t rex_in_savings = 0;
       static const time_point_sec end_of_days = time_point_sec::maximum();
-      if ( !bitr->rex_maturities.empty() && bitr->rex_maturities.back().first == end_of_days ) {
-         _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-            rex_in_savings = rb.rex_maturities.back().second;
-            rb.rex_maturities.pop_back();
-         });
+      if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == end_of_days ) {
+         rex_in_savings = rb.rex_maturities.back().second;
+         rb.rex_maturities.pop_back();
       }
       return rex_in_savings;
    }
@@ -1200,19 +1355,32 @@ namespace eosiosystem {
    /**
     * @brief Adds a specified REX amount to savings bucket
     *
-    * @param bitr - iterator pointing to rex_balance object
+    * @param rb - working copy of the owner rex_balance object
     * @param rex - amount of REX to be added
     */
-   void system_contract::put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex )
+   void system_contract::put_rex_savings( rex_balance& rb, int64_t rex )
    {
       if ( rex == 0 ) return;
       static const time_point_sec end_of_days = time_point_sec::maximum();
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == end_of_days ) {
-            rb.rex_maturities.back().second += rex;
-         } else {
-            rb.rex_maturities.emplace_back( pair_time_point_sec_int64{ end_of_days, rex } );
-         }
+      if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == end_of_days ) {
+         rb.rex_maturities.back().second += rex;
+      } else {
+         rb.rex_maturities.emplace_back( pair_time_point_sec_int64{ end_of_days, rex } );
+      }
+   }
+
+   /**
+    * @brief Writes a working copy of a rex_balance object back to its row
+    *
+    * The helpers above only update the working copy, so that each REX action serializes the row once.
+    *
+    * @param bitr - iterator pointing to rex_balance object
+    * @param rb - updated working copy
+    */
+   void system_contract::store_rex_balance( const rex_balance_table::const_iterator& bitr, const rex_balance& rb )
+   {
+      _rexbalance.modify( bitr, same_payer, [&]( auto& b ) {
+         b = rb;
       });
    }
 
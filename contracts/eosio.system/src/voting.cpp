@@ -10,6 +10,7 @@
 #include <eosio.system/eosio.system.hpp>
 #include <eosio.token/eosio.token.hpp>
 
+#include <array>
 #include <type_traits>
 #include <limits>
 #include <set>
@@ -22,7 +23,14 @@ namespace eosiosystem {
    using eosio::current_time_point;
    using eosio::indexed_by;
    using eosio::microseconds;
-   using eosio::singleton;
+
+   static constexpr size_t max_producer_votes = 30;
+
+   // Whether `producers` names the same producers in the same order as `names`
+   static bool same_producer_names( const std::vector<eosio::producer_authority>& producers, const std::vector<name>& names ) {
+      return std::equal( producers.begin(), producers.end(), names.begin(), names.end(),
+                         []( const eosio::producer_authority& p, const name& n ) { return p.producer_name == n; } );
+   }
 
    void system_contract::register_producer( const name& producer, const eosio::block_signing_authority& producer_authority, const std::string& url, uint16_t location ) {
       auto prod = _producers.find( producer.value );
@@ -47,6 +55,8 @@ namespace eosiosystem {
             if ( info.last_claim_time == time_point() )
                info.last_claim_time = ct;
          });
+         update_producer_ranking( *prod );
+         invalidate_visited_producers();
 
          auto prod2 = _producers2.find( producer.value );
          if ( prod2 == _producers2.end() ) {
@@ -58,7 +68,7 @@ namespace eosiosystem {
             // When introducing the producer2 table row for the first time, the producer's votes must also be accounted for in the global total_producer_votepay_share at the same time.
          }
       } else {
-         _producers.emplace( producer, [&]( producer_info& info ){
+         prod = _producers.emplace( producer, [&]( producer_info& info ){
             info.owner              = producer;
             info.total_votes        = 0;
             info.producer_key       = producer_key;
@@ -68,6 +78,7 @@ namespace eosiosystem {
             info.last_claim_time    = ct;
             info.producer_authority.emplace( producer_authority );
          });
+         update_producer_ranking( *prod );
          _producers2.emplace( producer, [&]( producer_info2& info ){
             info.owner                     = producer;
             info.last_votepay_share_update = ct;
@@ -101,33 +112,41 @@ namespace eosiosystem {
       _producers.modify( prod, same_payer, [&]( producer_info& info ){
          info.deactivate();
       });
+      update_producer_ranking( prod );
    }
 
    void system_contract::update_elected_producers( const block_timestamp& block_time ) {
-      _gstate.last_producer_schedule_update = block_time;
+      flush_vote_tally();
 
-      auto idx = _producers.get_index<"prototalvote"_n>();
+      _gstate->last_producer_schedule_update = block_time;
+
+      auto last_prop = _last_prop_producers.find( 0 );
+      if( last_prop != _last_prop_producers.end() && top_producers_unchanged( *last_prop ) ) {
+         return;
+      }
 
       using value_type = std::pair<eosio::producer_authority, uint16_t>;
       std::vector< value_type > top_producers;
       std::vector< finalizer_auth_info > proposed_finalizers;
+      std::vector< name > visited_producers;
       top_producers.reserve(21);
       proposed_finalizers.reserve(21);
 
       bool is_savanna = is_savanna_consensus();
 
-      for( auto it = idx.cbegin(); it != idx.cend() && top_producers.size() < 21 && 0 < it->total_votes && it->active(); ++it ) {
+      visit_top_producers( [&]( const producer_info& prod ) {
+         visited_producers.push_back( prod.owner );
          if( is_savanna ) {
-            auto finalizer = _finalizers.find( it->owner.value );
+            auto finalizer = _finalizers.find( prod.owner.value );
             if( finalizer == _finalizers.end() ) {
                // The producer is not in finalizers table, indicating it does not have an
                // active registered finalizer key. Try next one.
-               continue;
+               return true;
             }
 
             // This should never happen. Double check just in case
             if( finalizer->active_key_binary.empty() ) {
-               continue;
+               return true;
             }
 
             proposed_finalizers.emplace_back(*finalizer);
@@ -135,14 +154,15 @@ namespace eosiosystem {
 
          top_producers.emplace_back(
             eosio::producer_authority{
-               .producer_name = it->owner,
-               .authority     = it->get_producer_authority()
+               .producer_name = prod.owner,
+               .authority     = prod.get_producer_authority()
             },
-            it->location
+            prod.location
          );
-      }
+         return top_producers.size() < 21;
+      });
 
-      if( top_producers.size() == 0 || top_producers.size() < _gstate.last_producer_schedule_size ) {
+      if( top_producers.size() == 0 || top_producers.size() < _gstate->last_producer_schedule_size ) {
          return;
       }
 
@@ -157,8 +177,41 @@ namespace eosiosystem {
       for( auto& item : top_producers )
          producers.push_back( std::move(item.first) );
 
-      if( set_proposed_producers( producers ) >= 0 ) {
-         _gstate.last_producer_schedule_size = static_cast<decltype(_gstate.last_producer_schedule_size)>( producers.size() );
+      // Only propose the schedule if it differs from the one accepted last time. The host rejects a proposal while an
+      // earlier one is still waiting to become pending, so the digest is only stored once the schedule was accepted.
+      const auto packed_producers = eosio::pack( producers );
+      const auto schedule_hash    = eosio::sha256( packed_producers.data(), packed_producers.size() );
+      const bool schedule_changed = last_prop == _last_prop_producers.end() || last_prop->schedule_hash != schedule_hash;
+      bool accepted = !schedule_changed;
+      if( schedule_changed ) {
+         if( set_proposed_producers( producers ) >= 0 ) {
+            _gstate->last_producer_schedule_size = static_cast<decltype(_gstate->last_producer_schedule_size)>( producers.size() );
+            accepted = true;
+         } else if( last_prop == _last_prop_producers.end() ) {
+            // The host also rejects a schedule equal to the active one. Until a digest is stored, e.g. right after this
+            // contract is deployed on a chain whose schedule is stable, a rejected schedule naming the active producers
+            // is taken to be the one in effect. The host only exposes the names of the active producers.
+            accepted = same_producer_names( producers, eosio::get_active_producers() );
+         }
+      }
+
+      // a shorter schedule may grow once more producers get votes, so it is built again next time
+      if( top_producers.size() < 21 ) {
+         visited_producers.clear();
+      }
+      if( !accepted ) {
+         // a rejected schedule must be built and proposed again by the next update
+         invalidate_visited_producers();
+      } else if( last_prop == _last_prop_producers.end() ) {
+         _last_prop_producers.emplace( get_self(), [&]( auto& p ) {
+            p.schedule_hash = schedule_hash;
+            p.visited_producers.emplace( std::move(visited_producers) );
+         });
+      } else if( schedule_changed || !last_prop->visited_producers.has_value() || last_prop->visited_producers.value() != visited_producers ) {
+         _last_prop_producers.modify( last_prop, same_payer, [&]( auto& p ) {
+            p.schedule_hash = schedule_hash;
+            p.visited_producers.emplace( std::move(visited_producers) );
+         });
       }
 
       // set_proposed_finalizers() checks if last proposed finalizer policy
@@ -168,10 +221,109 @@ namespace eosiosystem {
       }
    }
 
+   // True if the active producers at the top of the ranking are still the ones visited by the last schedule build.
+   // Since re-registering and changing finalizer keys clear the visited producers, the build would then produce the
+   // same schedule and finalizer policy again.
+   bool system_contract::top_producers_unchanged( const last_prop_producers_info& last_prop ) {
+      if( !last_prop.visited_producers.has_value() || last_prop.visited_producers.value().empty() ) {
+         return false;
+      }
+      const auto& visited = last_prop.visited_producers.value();
+      size_t i = 0;
+      for( const auto& r : get_producer_ranking().producers ) {
+         if( !r.is_active ) continue;
+         if( r.total_votes <= 0 || r.owner != visited[i] ) return false;
+         if( ++i == visited.size() ) return true;
+      }
+      return false;
+   }
+
+   // Must be called whenever the authority of a producer or the active finalizer key of a finalizer changes, and when
+   // the host rejects a proposed schedule
+   void system_contract::invalidate_visited_producers() {
+      auto last_prop = _last_prop_producers.find( 0 );
+      if( last_prop == _last_prop_producers.end() || !last_prop->visited_producers.has_value() || last_prop->visited_producers.value().empty() ) {
+         return;
+      }
+      _last_prop_producers.modify( last_prop, same_payer, [&]( auto& p ) {
+         p.visited_producers.emplace();
+      });
+   }
+
+   const producer_ranking_info& system_contract::get_producer_ranking() {
+      if( !_producer_ranking_cached.has_value() ) {
+         auto itr = _producer_ranking.find( 0 );
+         if( itr != _producer_ranking.end() ) {
+            _producer_ranking_cached = *itr;
+         } else {
+            _producer_ranking_cached.emplace( producer_ranking_info{ build_producer_ranking( _producers ) } );
+            _producer_ranking_dirty = true;
+         }
+      }
+      return *_producer_ranking_cached;
+   }
+
+   // Must be called after every change of the votes or the activation of `prod`
+   void system_contract::update_producer_ranking( const producer_info& prod ) {
+      get_producer_ranking();
+      auto& ranking = _producer_ranking_cached->producers;
+
+      const ranked_producer entry{ prod.owner, prod.total_votes, prod.active() };
+      const bool full = ranking.size() >= producer_ranking_size;
+      auto by_rank = []( const ranked_producer& a, const ranked_producer& b ) { return a.ranks_before( b ); };
+
+      auto itr = std::find_if( ranking.begin(), ranking.end(), [&]( const auto& r ) { return r.owner == prod.owner; } );
+      if( itr != ranking.end() ) {
+         if( itr->total_votes == entry.total_votes && itr->is_active == entry.is_active )
+            return;
+         ranking.erase( itr );
+         if( full && ( !entry.eligible() || ( !ranking.empty() && ranking.back().ranks_before( entry ) ) ) ) {
+            // the producer dropped to the boundary of the ranking, some unranked producer may now rank before it
+            ranking = build_producer_ranking( _producers );
+         } else if( entry.eligible() ) {
+            ranking.insert( std::upper_bound( ranking.begin(), ranking.end(), entry, by_rank ), entry );
+         }
+      } else {
+         if( !entry.eligible() || ( full && ranking.back().ranks_before( entry ) ) )
+            return;
+         ranking.insert( std::upper_bound( ranking.begin(), ranking.end(), entry, by_rank ), entry );
+         if( ranking.size() > producer_ranking_size )
+            ranking.pop_back();
+      }
+      _producer_ranking_dirty = true;
+   }
+
+   void system_contract::save_producer_ranking() {
+      if( !_producer_ranking_dirty )
+         return;
+      auto itr = _producer_ranking.find( 0 );
+      if( itr == _producer_ranking.end() ) {
+         _producer_ranking.emplace( get_self(), [&]( auto& r ) {
+            r = *_producer_ranking_cached;
+         });
+      } else {
+         _producer_ranking.modify( itr, same_payer, [&]( auto& r ) {
+            r = *_producer_ranking_cached;
+         });
+      }
+      _producer_ranking_dirty = false;
+   }
+
+   std::vector<ranked_producer> system_contract::getranking() {
+      return read_producer_ranking( get_self() );
+   }
+
    double stake2vote( int64_t staked ) {
-      /// TODO subtract 2080 brings the large numbers closer to this decade
-      double weight = int64_t( (current_time_point().sec_since_epoch() - (block_timestamp::block_timestamp_epoch / 1000)) / (seconds_per_day * 7) )  / double( 52 );
-      return double(staked) * std::pow( 2, weight );
+      const int64_t weeks = int64_t( (current_time_point().sec_since_epoch() - (block_timestamp::block_timestamp_epoch / 1000)) / (seconds_per_day * 7) );
+
+      // the factor only changes once a week, compute it once per action rather than once per voter
+      static int64_t cached_weeks  = -1;
+      static double  cached_factor = 0;
+      if( weeks != cached_weeks ) {
+         cached_weeks  = weeks;
+         cached_factor = std::pow( 2, weeks / double( 52 ) );
+      }
+      return double(staked) * cached_factor;
    }
 
    double system_contract::update_total_votepay_share( const time_point& ct,
@@ -179,27 +331,27 @@ namespace eosiosystem {
                                                        double shares_rate_delta )
    {
       double delta_total_votepay_share = 0.0;
-      if( ct > _gstate3.last_vpay_state_update ) {
-         delta_total_votepay_share = _gstate3.total_vpay_share_change_rate
-                                       * double( (ct - _gstate3.last_vpay_state_update).count() / 1E6 );
+      if( ct > _gstate3->last_vpay_state_update ) {
+         delta_total_votepay_share = _gstate3->total_vpay_share_change_rate
+                                       * double( (ct - _gstate3->last_vpay_state_update).count() / 1E6 );
       }
 
       delta_total_votepay_share += additional_shares_delta;
-      if( delta_total_votepay_share < 0 && _gstate2.total_producer_votepay_share < -delta_total_votepay_share ) {
-         _gstate2.total_producer_votepay_share = 0.0;
+      if( delta_total_votepay_share < 0 && _gstate2->total_producer_votepay_share < -delta_total_votepay_share ) {
+         _gstate2->total_producer_votepay_share = 0.0;
       } else {
-         _gstate2.total_producer_votepay_share += delta_total_votepay_share;
+         _gstate2->total_producer_votepay_share += delta_total_votepay_share;
       }
 
-      if( shares_rate_delta < 0 && _gstate3.total_vpay_share_change_rate < -shares_rate_delta ) {
-         _gstate3.total_vpay_share_change_rate = 0.0;
+      if( shares_rate_delta < 0 && _gstate3->total_vpay_share_change_rate < -shares_rate_delta ) {
+         _gstate3->total_vpay_share_change_rate = 0.0;
       } else {
-         _gstate3.total_vpay_share_change_rate += shares_rate_delta;
+         _gstate3->total_vpay_share_change_rate += shares_rate_delta;
       }
 
-      _gstate3.last_vpay_state_update = ct;
+      _gstate3->last_vpay_state_update = ct;
 
-      return _gstate2.total_producer_votepay_share;
+      return _gstate2->total_producer_votepay_share;
    }
 
    double system_contract::update_producer_votepay_share( const producers_table2::const_iterator& prod_itr,
@@ -237,44 +389,122 @@ namespace eosiosystem {
    }
 
    void system_contract::voteupdate( const name& voter_name ) {
-      auto voter = _voters.find( voter_name.value );
-      check( voter != _voters.end(), "no voter found" );
+      voteupdates( { voter_name } );
+   } // voteupdate
+
+   void system_contract::voteupdates( const std::vector<name>& voter_names ) {
+      check( !voter_names.empty(), "no voters to update" );
+
+      // the vote updates of all voters only stage their changes, which are applied once below
+      weight_propagation changes;
+      _staged_votes = &changes;
 
-      int64_t new_staked = 0;
-      
-      updaterex(voter_name);
-      
-      // get rex bal
-      auto rex_itr = _rexbalance.find( voter_name.value );
-      if( rex_itr != _rexbalance.end() && rex_itr->rex_balance.amount > 0 ) {
-         new_staked += rex_itr->vote_stake.amount;
+      for( const auto& voter_name : voter_names ) {
+         auto voter = _voters.find( voter_name.value );
+         check( voter != _voters.end(), "no voter found" );
+
+         // does what updaterex does except updating the vote weight, the recomputed stake below supersedes its change
+         require_auth( voter_name );
+         asset rex_stake_change = refresh_rex_vote_stake( voter_name );
+         settle_rex_order( voter_name, asset( 0, core_symbol() ), rex_stake_change );
+
+         voter_stake_update stake;
+         int64_t new_staked = 0;
+
+         // get rex bal
+         auto rex_itr = _rexbalance.find( voter_name.value );
+         if( rex_itr != _rexbalance.end() && rex_itr->rex_balance.amount > 0 ) {
+            new_staked += rex_itr->vote_stake.amount;
+         }
+         new_staked += get_delegated_stake_total( voter, stake );
+         stake.staked_delta = new_staked - voter->staked;
+
+         // the stake and the vote are written to the voter row at once
+         const auto producers = get_voted_producers( *voter );
+         update_votes( voter_name, voter->proxy, producers, true, stake );
       }
-      del_bandwidth_table     del_tbl( get_self(), voter_name.value );
 
-      auto del_itr = del_tbl.begin();
-      while(del_itr != del_tbl.end()) {
-         new_staked += del_itr->net_weight.amount + del_itr->cpu_weight.amount;
-         del_itr++;
+      _staged_votes = nullptr;
+      propagate_weight_changes( changes );
+   } // voteupdates
+
+
+   void system_contract::cfgvotesets( bool enabled ) {
+      require_auth( get_self() );
+
+      vote_set_config_singleton config( get_self(), get_self().value );
+      auto cfg = config.get_or_default();
+      cfg.enabled = enabled;
+      config.set( cfg, get_self() );
+   }
+
+   const std::vector<name>& system_contract::get_voted_producers( const voter_info& voter ) {
+      if( !has_field( voter.flags1, voter_info::flags1_fields::interned_producers ) )
+         return voter.producers;
+      return _vote_sets.get( voter.reserved2, "vote set not found" ).producers; //data corruption
+   }
+
+   uint32_t system_contract::retain_vote_set( const std::vector<name>& producers ) {
+      const auto packed = eosio::pack( producers );
+      const auto hash   = eosio::sha256( packed.data(), packed.size() );
+
+      auto idx = _vote_sets.get_index<"byhash"_n>();
+      for( auto itr = idx.find( hash ); itr != idx.end() && itr->hash == hash; ++itr ) {
+         if( itr->producers == producers ) {
+            idx.modify( itr, same_payer, [&]( auto& vs ) {
+               ++vs.refcount;
+            });
+            return static_cast<uint32_t>( itr->id );
+         }
       }
 
-      if( voter->staked != new_staked){
-         // check if staked and new_staked are different and only
-         _voters.modify( voter, same_payer, [&]( auto& av ) {
-            av.staked = new_staked;
+      const uint64_t id = _vote_sets.available_primary_key();
+      check( id <= std::numeric_limits<uint32_t>::max(), "no vote set id available" );
+      _vote_sets.emplace( get_self(), [&]( auto& vs ) {
+         vs.id        = id;
+         vs.hash      = hash;
+         vs.producers = producers;
+         vs.refcount  = 1;
+      });
+      return static_cast<uint32_t>( id );
+   }
+
+   void system_contract::release_vote_set( uint32_t id ) {
+      const auto& vs = _vote_sets.get( id, "vote set not found" ); //data corruption
+      if( vs.refcount <= 1 ) {
+         _vote_sets.erase( vs );
+      } else {
+         _vote_sets.modify( vs, same_payer, [&]( auto& v ) {
+            --v.refcount;
          });
       }
-      
-      update_votes(voter_name, voter->proxy, voter->producers, true);
-   } // voteupdate
+   }
 
+   void system_contract::update_votes( const name& voter_name, const name& proxy, const std::vector<name>& producers, bool voting,
+                                       const voter_stake_update& stake ) {
+      if( _staged_votes ) {
+         stage_votes( *_staged_votes, voter_name, proxy, producers, voting, stake );
+         return;
+      }
 
-   void system_contract::update_votes( const name& voter_name, const name& proxy, const std::vector<name>& producers, bool voting ) {
+      weight_propagation changes;
+      stage_votes( changes, voter_name, proxy, producers, voting, stake );
+      propagate_weight_changes( changes );
+   }
+
+   /**
+    * Validates the vote and updates the voter row, adding the resulting changes of the proxies and producers to
+    * `changes`. Several votes can be staged before the changes are applied by propagate_weight_changes.
+    * The vote weight follows the stake after `stake` is applied, which is written with the vote.
+    */
+   void system_contract::stage_votes( weight_propagation& changes, const name& voter_name, const name& proxy,
+                                      const std::vector<name>& producers, bool voting, const voter_stake_update& stake ) {
       //validate input
       if ( proxy ) {
          check( producers.size() == 0, "cannot vote for producers and proxy at same time" );
          check( voter_name != proxy, "cannot proxy to self" );
       } else {
-         check( producers.size() <= 30, "attempt to vote for too many producers" );
+         check( producers.size() <= max_producer_votes, "attempt to vote for too many producers" );
          for( size_t i = 1; i < producers.size(); ++i ) {
             check( producers[i-1] < producers[i], "producer votes must be unique and sorted" );
          }
@@ -283,40 +513,29 @@ namespace eosiosystem {
       auto voter = _voters.find( voter_name.value );
       check( voter != _voters.end(), "user must stake before they can vote" ); /// staking creates voter object
       check( !proxy || !voter->is_proxy, "account registered as a proxy is not allowed to use a proxy" );
+      const int64_t staked = voter->staked + stake.staked_delta;
 
       /**
        * The first time someone votes we calculate and set last_vote_weight. Since they cannot unstake until
        * after the chain has been activated, we can use last_vote_weight to determine that this is
        * their first vote and should consider their stake activated.
        */
-      if( _gstate.thresh_activated_stake_time == time_point() && voter->last_vote_weight <= 0.0 ) {
-         _gstate.total_activated_stake += voter->staked;
-         if( _gstate.total_activated_stake >= min_activated_stake ) {
-            _gstate.thresh_activated_stake_time = current_time_point();
+      if( _gstate->thresh_activated_stake_time == time_point() && voter->last_vote_weight <= 0.0 ) {
+         _gstate->total_activated_stake += staked;
+         if( _gstate->total_activated_stake >= min_activated_stake ) {
+            _gstate->thresh_activated_stake_time = current_time_point();
          }
       }
 
-      auto new_vote_weight = stake2vote( voter->staked );
+      auto new_vote_weight = stake2vote( staked );
       if( voter->is_proxy ) {
          new_vote_weight += voter->proxied_vote_weight;
       }
 
-      std::map<name, std::pair<double, bool /*new*/> > producer_deltas;
-      if ( voter->last_vote_weight > 0 ) {
-         if( voter->proxy ) {
-            auto old_proxy = _voters.find( voter->proxy.value );
-            check( old_proxy != _voters.end(), "old proxy not found" ); //data corruption
-            _voters.modify( old_proxy, same_payer, [&]( auto& vp ) {
-                  vp.proxied_vote_weight -= voter->last_vote_weight;
-               });
-            propagate_weight_change( *old_proxy );
-         } else {
-            for( const auto& p : voter->producers ) {
-               auto& d = producer_deltas[p];
-               d.first -= voter->last_vote_weight;
-               d.second = false;
-            }
-         }
+      if ( voter->last_vote_weight > 0 && voter->proxy ) {
+         auto old_proxy = _voters.find( voter->proxy.value );
+         check( old_proxy != _voters.end(), "old proxy not found" ); //data corruption
+         changes.add_proxied_vote_weight( voter->proxy, -voter->last_vote_weight );
       }
 
       if( proxy ) {
@@ -324,73 +543,63 @@ namespace eosiosystem {
          check( new_proxy != _voters.end(), "invalid proxy specified" ); //if ( !voting ) { data corruption } else { wrong vote }
          check( !voting || new_proxy->is_proxy, "proxy not found" );
          if ( new_vote_weight >= 0 ) {
-            _voters.modify( new_proxy, same_payer, [&]( auto& vp ) {
-                  vp.proxied_vote_weight += new_vote_weight;
-               });
-            propagate_weight_change( *new_proxy );
-         }
-      } else {
-         if( new_vote_weight >= 0 ) {
-            for( const auto& p : producers ) {
-               auto& d = producer_deltas[p];
-               d.first += new_vote_weight;
-               d.second = true;
-            }
+            changes.add_proxied_vote_weight( proxy, new_vote_weight );
          }
       }
 
-      const auto ct = current_time_point();
-      double delta_change_rate         = 0.0;
-      double total_inactive_vpay_share = 0.0;
-      for( const auto& pd : producer_deltas ) {
-         auto pitr = _producers.find( pd.first.value );
-         if( pitr != _producers.end() ) {
-            if( voting && !pitr->active() && pd.second.second /* from new set */ ) {
-               check( false, ( "producer " + pitr->owner.to_string() + " is not currently registered" ).data() );
-            }
-            double init_total_votes = pitr->total_votes;
-            _producers.modify( pitr, same_payer, [&]( auto& p ) {
-               p.total_votes += pd.second.first;
-               if ( p.total_votes < 0 ) { // floating point arithmetics can give small negative numbers
-                  p.total_votes = 0;
-               }
-               _gstate.total_producer_vote_weight += pd.second.first;
-               //check( p.total_votes >= 0, "something bad happened" );
-            });
-            auto prod2 = _producers2.find( pd.first.value );
-            if( prod2 != _producers2.end() ) {
-               const auto last_claim_plus_3days = pitr->last_claim_time + microseconds(3 * useconds_per_day);
-               bool crossed_threshold       = (last_claim_plus_3days <= ct);
-               bool updated_after_threshold = (last_claim_plus_3days <= prod2->last_votepay_share_update);
-               // Note: updated_after_threshold implies cross_threshold
-
-               double new_votepay_share = update_producer_votepay_share( prod2,
-                                             ct,
-                                             updated_after_threshold ? 0.0 : init_total_votes,
-                                             crossed_threshold && !updated_after_threshold // only reset votepay_share once after threshold
-                                          );
-
-               if( !crossed_threshold ) {
-                  delta_change_rate += pd.second.first;
-               } else if( !updated_after_threshold ) {
-                  total_inactive_vpay_share += new_votepay_share;
-                  delta_change_rate -= init_total_votes;
-               }
-            }
+      // the previous and the new producers are both sorted, so merging them yields the deltas sorted by producer
+      const std::vector<name> no_producers;
+      const auto& voted_producers = get_voted_producers( *voter );
+      const auto& old_producers = ( voter->last_vote_weight > 0 && !voter->proxy ) ? voted_producers : no_producers;
+      const auto& new_producers = ( !proxy && new_vote_weight >= 0 ) ? producers : no_producers;
+      check( old_producers.size() <= max_producer_votes, "too many producers in previous vote" ); //data corruption
+
+      using pending_producer = weight_propagation::pending_producer;
+      std::array<pending_producer, 2 * max_producer_votes> producer_deltas;
+      size_t producer_deltas_size = 0;
+      for( size_t i = 0, j = 0; i < old_producers.size() || j < new_producers.size(); ) {
+         auto& d = producer_deltas[producer_deltas_size++];
+         if( j == new_producers.size() || ( i < old_producers.size() && old_producers[i] < new_producers[j] ) ) {
+            d = { old_producers[i++], -voter->last_vote_weight };
+         } else if( i == old_producers.size() || new_producers[j] < old_producers[i] ) {
+            d = { new_producers[j++], new_vote_weight, true, voting };
          } else {
-            if( pd.second.second ) {
-               check( false, ( "producer " + pd.first.to_string() + " is not registered" ).data() );
-            }
+            d = { new_producers[j++], new_vote_weight - voter->last_vote_weight, true, voting };
+            ++i;
          }
       }
+      changes.add_producer_votes( producer_deltas.data(), producer_deltas_size );
+
+      // only votes switch between the producers stored in the voter row and a shared vote set; updates of the
+      // vote weight keep the producers where they are
+      const bool was_interned = has_field( voter->flags1, voter_info::flags1_fields::interned_producers );
+      bool       intern       = was_interned;
+      if( voting ) {
+         vote_set_config_singleton config( get_self(), get_self().value );
+         intern = !producers.empty() && config.get_or_default().enabled;
+      }
+      const bool keep_producers = intern == was_interned && producers == voted_producers;
 
-      update_total_votepay_share( ct, -total_inactive_vpay_share, delta_change_rate );
+      const uint32_t old_set = was_interned ? voter->reserved2 : 0;
+      uint32_t       new_set = old_set;
+      if( !keep_producers && intern ) {
+         new_set = retain_vote_set( producers );
+      }
 
       _voters.modify( voter, same_payer, [&]( auto& av ) {
+         stake.apply( av );
          av.last_vote_weight = new_vote_weight;
-         av.producers = producers;
          av.proxy     = proxy;
+         if( !keep_producers ) {
+            av.producers = intern ? std::vector<name>{} : producers;
+            av.flags1    = set_field( av.flags1, voter_info::flags1_fields::interned_producers, intern );
+            av.reserved2 = intern ? new_set : 0;
+         }
       });
+
+      if( !keep_producers && was_interned ) {
+         release_vote_set( old_set );
+      }
    }
 
    void system_contract::regproxy( const name& proxy, bool isproxy ) {
@@ -400,10 +609,9 @@ namespace eosiosystem {
       if ( pitr != _voters.end() ) {
          check( isproxy != pitr->is_proxy, "action has no effect" );
          check( !isproxy || !pitr->proxy, "account that uses a proxy is not allowed to become a proxy" );
-         _voters.modify( pitr, same_payer, [&]( auto& p ) {
-               p.is_proxy = isproxy;
-            });
-         propagate_weight_change( *pitr );
+         weight_propagation changes;
+         changes.voter( proxy ).is_proxy = isproxy;
+         propagate_weight_changes( changes );
       } else {
          _voters.emplace( proxy, [&]( auto& p ) {
                p.owner  = proxy;
@@ -412,63 +620,234 @@ namespace eosiosystem {
       }
    }
 
-   void system_contract::propagate_weight_change( const voter_info& voter ) {
-      check( !voter.proxy || !voter.is_proxy, "account registered as a proxy is not allowed to use a proxy" );
-      double new_weight = stake2vote( voter.staked );
-      if ( voter.is_proxy ) {
-         new_weight += voter.proxied_vote_weight;
-      }
+   system_contract::weight_propagation::pending_voter& system_contract::weight_propagation::voter( const name& owner ) {
+      auto itr = std::find_if( voters.begin(), voters.end(), [&]( const auto& v ) { return v.owner == owner; } );
+      if( itr != voters.end() )
+         return *itr;
+      return voters.emplace_back( pending_voter{ owner } );
+   }
 
-      /// don't propagate small changes (1 ~= epsilon)
-      if ( fabs( new_weight - voter.last_vote_weight ) > 1 )  {
-         if ( voter.proxy ) {
-            auto& proxy = _voters.get( voter.proxy.value, "proxy not found" ); //data corruption
-            _voters.modify( proxy, same_payer, [&]( auto& p ) {
-                  p.proxied_vote_weight += new_weight - voter.last_vote_weight;
-               }
-            );
-            propagate_weight_change( proxy );
+   void system_contract::weight_propagation::add_proxied_vote_weight( const name& proxy, double delta ) {
+      auto& v = voter( proxy );
+      v.proxied_vote_weight_delta += delta;
+      v.resolved = false;
+   }
+
+   void system_contract::weight_propagation::add_producer_votes( const name& producer, double delta, bool new_vote, bool voting ) {
+      auto itr = std::lower_bound( producers.begin(), producers.end(), producer,
+                                   []( const auto& p, const name& owner ) { return p.owner < owner; } );
+      if( itr == producers.end() || itr->owner != producer )
+         itr = producers.insert( itr, pending_producer{ producer } );
+      itr->vote_delta         += delta;
+      itr->must_be_registered |= new_vote;
+      itr->must_be_active     |= new_vote && voting;
+   }
+
+   // Adds the sorted deltas of one vote with a single merge into the pending producers
+   void system_contract::weight_propagation::add_producer_votes( const pending_producer* deltas, size_t count ) {
+      if( count == 0 ) {
+         return;
+      }
+      if( producers.empty() ) {
+         producers.assign( deltas, deltas + count );
+         return;
+      }
+      std::vector<pending_producer> merged;
+      merged.reserve( producers.size() + count );
+      for( size_t i = 0, j = 0; i < producers.size() || j < count; ) {
+         if( j == count || ( i < producers.size() && producers[i].owner < deltas[j].owner ) ) {
+            merged.push_back( producers[i++] );
+         } else if( i == producers.size() || deltas[j].owner < producers[i].owner ) {
+            merged.push_back( deltas[j++] );
          } else {
-            auto delta = new_weight - voter.last_vote_weight;
-            const auto ct = current_time_point();
-            double delta_change_rate         = 0;
-            double total_inactive_vpay_share = 0;
-            for ( auto acnt : voter.producers ) {
-               auto& prod = _producers.get( acnt.value, "producer not found" ); //data corruption
-               const double init_total_votes = prod.total_votes;
-               _producers.modify( prod, same_payer, [&]( auto& p ) {
-                  p.total_votes += delta;
-                  _gstate.total_producer_vote_weight += delta;
-               });
-               auto prod2 = _producers2.find( acnt.value );
-               if ( prod2 != _producers2.end() ) {
-                  const auto last_claim_plus_3days = prod.last_claim_time + microseconds(3 * useconds_per_day);
-                  bool crossed_threshold       = (last_claim_plus_3days <= ct);
-                  bool updated_after_threshold = (last_claim_plus_3days <= prod2->last_votepay_share_update);
-                  // Note: updated_after_threshold implies cross_threshold
-
-                  double new_votepay_share = update_producer_votepay_share( prod2,
-                                                ct,
-                                                updated_after_threshold ? 0.0 : init_total_votes,
-                                                crossed_threshold && !updated_after_threshold // only reset votepay_share once after threshold
-                                             );
-
-                  if( !crossed_threshold ) {
-                     delta_change_rate += delta;
-                  } else if( !updated_after_threshold ) {
-                     total_inactive_vpay_share += new_votepay_share;
-                     delta_change_rate -= init_total_votes;
+            auto& p = merged.emplace_back( producers[i++] );
+            p.vote_delta         += deltas[j].vote_delta;
+            p.must_be_registered |= deltas[j].must_be_registered;
+            p.must_be_active     |= deltas[j].must_be_active;
+            ++j;
+         }
+      }
+      producers = std::move( merged );
+   }
+
+   /**
+    * Propagates the pending changes of `changes` through proxies down to the voted producers, then writes every
+    * touched producer and voter row once. While deferred vote tallying is enabled, the changes of the producers are
+    * added to the `votetally` row instead, see flush_vote_tally.
+    *
+    * A voter whose weight changes by more than 1 passes the change on to its proxy or to its producers. The voters
+    * are resolved iteratively: resolving a voter may add weight to its proxy, which is then resolved again in the
+    * next pass, so accumulating several changes of the same proxy only propagates their net effect once. A proxy is
+    * not allowed to use a proxy itself, so this takes at most two passes over the voters plus a final check.
+    */
+   void system_contract::propagate_weight_changes( weight_propagation& changes ) {
+      for( bool pending = true; pending; ) {
+         pending = false;
+         for( size_t i = 0; i < changes.voters.size(); ++i ) {
+            if( changes.voters[i].resolved )
+               continue;
+            changes.voters[i].resolved = true;
+
+            const auto& voter    = _voters.get( changes.voters[i].owner.value, "proxy not found" ); //data corruption
+            const bool  is_proxy = changes.voters[i].is_proxy.value_or( voter.is_proxy );
+            check( !voter.proxy || !is_proxy, "account registered as a proxy is not allowed to use a proxy" );
+
+            double new_weight = stake2vote( voter.staked );
+            if ( is_proxy ) {
+               new_weight += voter.proxied_vote_weight + changes.voters[i].proxied_vote_weight_delta;
+            }
+            const double last_weight = changes.voters[i].last_vote_weight.value_or( voter.last_vote_weight );
+
+            changes.voters[i].last_vote_weight = new_weight;
+
+            /// don't propagate small changes (1 ~= epsilon)
+            if ( fabs( new_weight - last_weight ) > 1 ) {
+               if ( voter.proxy ) {
+                  changes.add_proxied_vote_weight( voter.proxy, new_weight - last_weight );
+                  pending = true;
+               } else {
+                  for ( auto acnt : get_voted_producers( voter ) ) {
+                     changes.add_producer_votes( acnt, new_weight - last_weight );
                   }
                }
             }
+         }
+      }
 
-            update_total_votepay_share( ct, -total_inactive_vpay_share, delta_change_rate );
+      std::vector<producer_vote_delta> deltas;
+      deltas.reserve( changes.producers.size() );
+      for ( const auto& pending : changes.producers ) {
+         if( pending.must_be_registered ) {
+            auto pitr = _producers.find( pending.owner.value );
+            if( pitr == _producers.end() ) {
+               check( false, ( "producer " + pending.owner.to_string() + " is not registered" ).data() );
+            }
+            if( pending.must_be_active && !pitr->active() ) {
+               check( false, ( "producer " + pitr->owner.to_string() + " is not currently registered" ).data() );
+            }
+         }
+         // e.g. an unchanged vote cast again within the same week: the votepay share keeps accruing at the same
+         // rate and is brought up to date by the next update of the producer, as if it had not been touched
+         if( pending.vote_delta != 0 ) {
+            deltas.push_back( producer_vote_delta{ pending.owner, pending.vote_delta } );
          }
       }
-      _voters.modify( voter, same_payer, [&]( auto& v ) {
-            v.last_vote_weight = new_weight;
+
+      if( !deltas.empty() ) {
+         vote_tally_table tally( get_self(), get_self().value );
+         auto tally_itr = tally.find( 0 );
+         if( tally_itr == tally.end() ) {
+            apply_producer_vote_deltas( deltas );
+         } else {
+            // both are sorted by producer, merge them
+            tally.modify( tally_itr, same_payer, [&]( auto& t ) {
+               std::vector<producer_vote_delta> merged;
+               merged.reserve( t.deltas.size() + deltas.size() );
+               auto it = t.deltas.begin();
+               for( const auto& d : deltas ) {
+                  for( ; it != t.deltas.end() && it->producer < d.producer; ++it ) {
+                     merged.push_back( *it );
+                  }
+                  if( it != t.deltas.end() && it->producer == d.producer ) {
+                     merged.push_back( producer_vote_delta{ d.producer, it->delta + d.delta } );
+                     ++it;
+                  } else {
+                     merged.push_back( d );
+                  }
+               }
+               merged.insert( merged.end(), it, t.deltas.end() );
+               t.deltas = std::move( merged );
+            });
+         }
+      }
+
+      for( const auto& pending : changes.voters ) {
+         _voters.modify( _voters.get( pending.owner.value ), same_payer, [&]( auto& v ) {
+            v.proxied_vote_weight += pending.proxied_vote_weight_delta;
+            if( pending.is_proxy )
+               v.is_proxy = *pending.is_proxy;
+            v.last_vote_weight = pending.last_vote_weight.value_or( v.last_vote_weight );
+         });
+      }
+
+#ifdef SYSTEM_PROFILE_DB_ACCESS
+      eosio::print( "vote weight propagation: voters=", changes.voters.size(), " producers=", changes.producers.size(), "\n" );
+#endif
+   }
+
+   /**
+    * Applies the vote changes to the producers, their votepay shares and the global vote totals. Producers that do
+    * not exist (anymore) are skipped, votes for unregistered producers are rejected when the vote is cast.
+    */
+   void system_contract::apply_producer_vote_deltas( const std::vector<producer_vote_delta>& deltas ) {
+      const auto ct = current_time_point();
+      double delta_change_rate         = 0;
+      double total_inactive_vpay_share = 0;
+      for ( const auto& [producer, delta] : deltas ) {
+         auto pitr = _producers.find( producer.value );
+         if( pitr == _producers.end() )
+            continue;
+         const double init_total_votes = pitr->total_votes;
+         _producers.modify( pitr, same_payer, [&]( auto& p ) {
+            p.total_votes += delta;
+            if ( p.total_votes < 0 ) { // floating point arithmetics can give small negative numbers
+               p.total_votes = 0;
+            }
+            _gstate->total_producer_vote_weight += delta;
+         });
+         update_producer_ranking( *pitr );
+         auto prod2 = _producers2.find( producer.value );
+         if ( prod2 != _producers2.end() ) {
+            const auto last_claim_plus_3days = pitr->last_claim_time + microseconds(3 * useconds_per_day);
+            bool crossed_threshold       = (last_claim_plus_3days <= ct);
+            bool updated_after_threshold = (last_claim_plus_3days <= prod2->last_votepay_share_update);
+            // Note: updated_after_threshold implies cross_threshold
+
+            double new_votepay_share = update_producer_votepay_share( prod2,
+                                          ct,
+                                          updated_after_threshold ? 0.0 : init_total_votes,
+                                          crossed_threshold && !updated_after_threshold // only reset votepay_share once after threshold
+                                       );
+
+            if( !crossed_threshold ) {
+               delta_change_rate += delta;
+            } else if( !updated_after_threshold ) {
+               total_inactive_vpay_share += new_votepay_share;
+               delta_change_rate -= init_total_votes;
+            }
          }
-      );
+      }
+
+      update_total_votepay_share( ct, -total_inactive_vpay_share, delta_change_rate );
+   }
+
+   void system_contract::flush_vote_tally() {
+      vote_tally_table tally( get_self(), get_self().value );
+      auto itr = tally.find( 0 );
+      if( itr == tally.end() || itr->deltas.empty() )
+         return;
+
+      const auto deltas = itr->deltas;
+      tally.modify( itr, same_payer, [&]( auto& t ) {
+         t.deltas.clear();
+      });
+      apply_producer_vote_deltas( deltas );
+   }
+
+   void system_contract::cfgvotetally( bool deferred ) {
+      require_auth( get_self() );
+
+      vote_tally_table tally( get_self(), get_self().value );
+      auto itr = tally.find( 0 );
+      if( deferred ) {
+         check( itr == tally.end(), "deferred vote tallying is already enabled" );
+         tally.emplace( get_self(), [&]( auto& t ) {} );
+      } else {
+         check( itr != tally.end(), "deferred vote tallying is not enabled" );
+         const auto deltas = itr->deltas;
+         tally.erase( itr );
+         apply_producer_vote_deltas( deltas );
+      }
    }
 
 } /// namespace eosiosystem
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "../eosio.system_tester.hpp"
+
+#include <fc/io/json.hpp>
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace eosio_system {
+
+// Cost of a single measured transaction, extracted from its trace.
+struct action_cost {
+   std::string                     contract;
+   std::string                     label;
+   uint32_t                        cpu_us         = 0;
+   uint64_t                        net_bytes      = 0;
+   std::map<std::string, int64_t>  ram_deltas;             // per payer
+   uint32_t                        inline_actions = 0;
+   uint32_t                        notifications  = 0;
+
+   std::string key() const { return contract + "::" + label; }
+};
+
+// Collects measurements of the whole run, compares them against the checked-in baseline and writes
+// the results as JSON and CSV once all benchmark suites have completed.
+//
+// Options are passed after `--` on the command line, i.e. `benchmark -- --bench-output=<dir>`:
+//   --bench-output=<dir>          directory receiving benchmark.json and benchmark.csv
+//   --bench-baseline=<file>       baseline to compare against
+//   --bench-cpu-tolerance=<pct>   allowed billed CPU growth before a warning is issued (default 25)
+//   --bench-update-baseline       overwrite the baseline with the results of this run
+//   --bench-scale=<factor>        multiplier applied to the mainnet-shaped state fixture (default 1)
+//
+// NET bytes, RAM deltas and inline action counts are deterministic and any growth fails the run;
+// billed CPU depends on the host, so it is only reported as a warning. A measurement without a baseline
+// entry fails the run as well. It is only reported as a warning while the baseline is empty, until it is recorded
+// with --bench-update-baseline, and when running at a different --bench-scale than the baseline was recorded at.
+class benchmark_recorder {
+public:
+   static benchmark_recorder& instance() {
+      static benchmark_recorder r;
+      return r;
+   }
+
+   void configure( int argc, char* argv[] ) {
+      for( int i = 0; i < argc; ++i ) {
+         std::string arg = argv[i];
+         if( arg.rfind("--bench-output=", 0) == 0 )
+            output_dir = arg.substr( sizeof("--bench-output=") - 1 );
+         else if( arg.rfind("--bench-baseline=", 0) == 0 )
+            baseline_file = arg.substr( sizeof("--bench-baseline=") - 1 );
+         else if( arg.rfind("--bench-cpu-tolerance=", 0) == 0 )
+            cpu_tolerance_pct = std::stod( arg.substr( sizeof("--bench-cpu-tolerance=") - 1 ) );
+         else if( arg == "--bench-update-baseline" )
+            update_baseline = true;
+         else if( arg.rfind("--bench-scale=", 0) == 0 )
+            scale = std::stod( arg.substr( sizeof("--bench-scale=") - 1 ) );
+      }
+      load_baseline();
+   }
+
+   double scale_factor() const { return scale; }
+
+   void record( action_cost cost ) {
+      auto itr = baseline.find( cost.key() );
+      if( itr == baseline.end() && !update_baseline && !baseline_file.empty() ) {
+         if( baseline.empty() || scale != 1 )
+            BOOST_WARN_MESSAGE( false, cost.key() << " has no entry in " << baseline_file << " and is not compared" );
+         else
+            BOOST_ERROR( cost.key() << " has no entry in " << baseline_file << ", record it with --bench-update-baseline" );
+      }
+      if( itr != baseline.end() && !update_baseline ) {
+         const action_cost& base = itr->second;
+         BOOST_CHECK_MESSAGE( cost.net_bytes <= base.net_bytes,
+                              cost.key() << " NET bytes regressed: " << cost.net_bytes << " > " << base.net_bytes );
+         BOOST_CHECK_MESSAGE( cost.inline_actions <= base.inline_actions,
+                              cost.key() << " inline actions regressed: " << cost.inline_actions << " > " << base.inline_actions );
+         for( const auto& [payer, delta] : cost.ram_deltas ) {
+            auto b = base.ram_deltas.find( payer );
+            const int64_t base_delta = b == base.ram_deltas.end() ? 0 : b->second;
+            BOOST_CHECK_MESSAGE( delta <= base_delta,
+                                 cost.key() << " RAM delta of " << payer << " regressed: " << delta << " > " << base_delta );
+         }
+         BOOST_WARN_MESSAGE( cost.cpu_us <= base.cpu_us * (1.0 + cpu_tolerance_pct / 100.0),
+                             cost.key() << " billed CPU grew: " << cost.cpu_us << "us > " << base.cpu_us << "us" );
+      }
+      results.emplace_back( std::move(cost) );
+   }
+
+   void write() const {
+      if( results.empty() )
+         return;
+
+      fc::variants rows;
+      rows.reserve( results.size() );
+      for( const auto& r : results ) {
+         rows.emplace_back( to_variant( r ) );
+      }
+      const fc::variant doc = mvo()("results", rows);
+
+      if( !output_dir.empty() ) {
+         std::filesystem::create_directories( output_dir );
+         fc::json::save_to_file( doc, std::filesystem::path(output_dir) / "benchmark.json", true );
+
+         std::ofstream csv( std::filesystem::path(output_dir) / "benchmark.csv" );
+         csv << "contract,action,cpu_us,net_bytes,ram_delta,inline_actions,notifications\n";
+         for( const auto& r : results ) {
+            int64_t ram = 0;
+            for( const auto& [payer, delta] : r.ram_deltas ) ram += delta;
+            csv << r.contract << ',' << r.label << ',' << r.cpu_us << ',' << r.net_bytes << ',' << ram << ','
+                << r.inline_actions << ',' << r.notifications << '\n';
+         }
+      }
+      if( update_baseline && !baseline_file.empty() ) {
+         fc::json::save_to_file( doc, std::filesystem::path(baseline_file), true );
+      }
+   }
+
+private:
+   static fc::variant to_variant( const action_cost& r ) {
+      mvo ram;
+      for( const auto& [payer, delta] : r.ram_deltas ) ram( payer, delta );
+      return mvo()("contract", r.contract)
+                  ("action", r.label)
+                  ("cpu_us", r.cpu_us)
+                  ("net_bytes", r.net_bytes)
+                  ("ram_deltas", ram)
+                  ("inline_actions", r.inline_actions)
+                  ("notifications", r.notifications);
+   }
+
+   void load_baseline() {
+      if( baseline_file.empty() || !std::filesystem::exists( baseline_file ) )
+         return;
+      const auto doc = fc::json::from_file( std::filesystem::path(baseline_file) );
+      for( const auto& row : doc["results"].get_array() ) {
+         action_cost c;
+         c.contract       = row["contract"].as_string();
+         c.label          = row["action"].as_string();
+         c.cpu_us         = static_cast<uint32_t>( row["cpu_us"].as_uint64() );
+         c.net_bytes      = row["net_bytes"].as_uint64();
+         c.inline_actions = static_cast<uint32_t>( row["inline_actions"].as_uint64() );
+         c.notifications  = static_cast<uint32_t>( row["notifications"].as_uint64() );
+         for( const auto& e : row["ram_deltas"].get_object() ) {
+            c.ram_deltas[e.key()] = e.value().as_int64();
+         }
+         baseline[c.key()] = std::move(c);
+      }
+   }
+
+   std::string                          output_dir;
+   std::string                          baseline_file;
+   double                               cpu_tolerance_pct = 25;
+   bool                                 update_baseline = false;
+   double                               scale = 1;
+   std::map<std::string, action_cost>   baseline;
+   std::vector<action_cost>             results;
+};
+
+class eosio_benchmark_tester : public eosio_system_tester {
+public:
+   using eosio_system_tester::eosio_system_tester;
+
+   static action_cost cost_of( const transaction_trace_ptr& trace ) {
+      action_cost cost;
+      BOOST_REQUIRE( trace && trace->receipt );
+      cost.cpu_us    = trace->receipt->cpu_usage_us;
+      cost.net_bytes = uint64_t(trace->receipt->net_usage_words) * 8;
+      for( const auto& at : trace->action_traces ) {
+         for( const auto& d : at.account_ram_deltas ) {
+            cost.ram_deltas[d.account.to_string()] += d.delta;
+         }
+         if( at.receiver != at.act.account )
+            ++cost.notifications;
+         else if( at.creator_action_ordinal.value != 0 )
+            ++cost.inline_actions;
+      }
+      return cost;
+   }
+
+   // Pushes `act` in its own transaction, records its cost under `contract::label` and returns the trace.
+   transaction_trace_ptr measure( const std::string& label, const account_name& contract, const action_name& act,
+                                  const vector<account_name>& signers, const variant_object& data ) {
+      auto trace = base_tester::push_action( contract, act, signers, data );
+      record( contract, label, trace );
+      produce_block();
+      return trace;
+   }
+
+   transaction_trace_ptr measure( const account_name& contract, const action_name& act,
+                                  const account_name& signer, const variant_object& data ) {
+      return measure( act.to_string(), contract, act, vector<account_name>{ signer }, data );
+   }
+
+   transaction_trace_ptr measure_system( const action_name& act, const account_name& signer, const variant_object& data ) {
+      return measure( config::system_account_name, act, signer, data );
+   }
+
+   transaction_trace_ptr measure_trx( const std::string& label, const account_name& contract, signed_transaction& trx,
+                                      const vector<account_name>& signers ) {
+      set_transaction_headers( trx );
+      for( const auto& s : signers ) {
+         trx.sign( get_private_key( s, "active" ), control->get_chain_id() );
+      }
+      auto trace = push_transaction( trx );
+      record( contract, label, trace );
+      produce_block();
+      return trace;
+   }
+
+   // Pushes `act` in its own read-only transaction and records its cost under `contract::label`.
+   transaction_trace_ptr measure_read_only( const std::string& label, const account_name& contract, const action_name& act,
+                                            const variant_object& data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( get_action( contract, act, vector<permission_level>{}, data ) );
+      set_transaction_headers( trx );
+      auto trace = push_transaction( trx, fc::time_point::maximum(), DEFAULT_BILLED_CPU_TIME_US, false,
+                                     transaction_metadata::trx_type::read_only );
+      record( contract, label, trace );
+      return trace;
+   }
+
+   // Measures the implicit onblock transaction of the next block.
+   transaction_trace_ptr measure_onblock( const std::string& label = "onblock", fc::microseconds skip = fc::milliseconds(config::block_interval_ms) ) {
+      auto res = produce_block_ex( skip );
+      record( config::system_account_name, label, res.onblock_trace );
+      return res.onblock_trace;
+   }
+
+   void record( const account_name& contract, const std::string& label, const transaction_trace_ptr& trace ) {
+      auto cost = cost_of( trace );
+      cost.contract = contract.to_string();
+      cost.label    = label;
+      benchmark_recorder::instance().record( std::move(cost) );
+   }
+};
+
+} // namespace eosio_system
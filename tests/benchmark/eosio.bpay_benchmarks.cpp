@@ -0,0 +1,21 @@
+#include "benchmark_tester.hpp"
+
+using namespace eosio_system;
+
+BOOST_AUTO_TEST_SUITE(eosio_bpay_benchmarks)
+
+const name fees = "eosio.fees"_n;
+const name bpay = "eosio.bpay"_n;
+
+BOOST_FIXTURE_TEST_CASE( bpay_actions, eosio_benchmark_tester ) try {
+   transfer( config::system_account_name, fees, core_sym::from_string("100000.0000"), config::system_account_name );
+   auto producer_names = active_and_vote_producers();
+   produce_blocks( 250 );
+
+   // bpay::on_transfer is triggered by the notification of the fee transfer
+   measure( "on_transfer", "eosio.token"_n, "transfer"_n, { fees },
+            mvo()("from", fees)("to", bpay)("quantity", core_sym::from_string("1000.0000"))("memo", "") );
+   measure( bpay, "claimrewards"_n, producer_names[0], mvo()("owner", producer_names[0]) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,29 @@
+#include "benchmark_tester.hpp"
+
+using namespace eosio_system;
+
+BOOST_AUTO_TEST_SUITE(eosio_fees_benchmarks)
+
+const name fees = "eosio.fees"_n;
+
+BOOST_FIXTURE_TEST_CASE( fees_actions, eosio_benchmark_tester ) try {
+   // without REX the fees stay in eosio.fees
+   measure( "on_transfer.without_rex", "eosio.token"_n, "transfer"_n, { config::system_account_name },
+            mvo()("from", config::system_account_name)("to", fees)("quantity", core_sym::from_string("100.0000"))("memo", "") );
+
+   // with REX the fees are donated to the REX pool
+   const name alice = "alice"_n;
+   setup_rex_accounts( { alice }, core_sym::from_string("1000.0000") );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("10.0000") ) );
+   measure( "on_transfer.with_rex", "eosio.token"_n, "transfer"_n, { config::system_account_name },
+            mvo()("from", config::system_account_name)("to", fees)("quantity", core_sym::from_string("100.0000"))("memo", "") );
+
+   {
+      // eosio.fees has no ABI deployed, noop takes no arguments
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{fees, config::active_name}}, fees, "noop"_n, bytes{} );
+      measure_trx( "noop", fees, trx, { fees } );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
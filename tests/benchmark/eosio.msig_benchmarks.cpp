@@ -0,0 +1,38 @@
+#include "benchmark_tester.hpp"
+
+using namespace eosio_system;
+
+BOOST_AUTO_TEST_SUITE(eosio_msig_benchmarks)
+
+const name alice = "alice1111111"_n;
+const name bob   = "bob111111111"_n;
+const name msig  = "eosio.msig"_n;
+
+BOOST_FIXTURE_TEST_CASE( msig_actions, eosio_benchmark_tester ) try {
+   initialize_multisig();
+   transfer( config::system_account_name, alice, core_sym::from_string("1000.0000") );
+   transfer( config::system_account_name, bob, core_sym::from_string("1000.0000") );
+   BOOST_REQUIRE_EQUAL( success(), buyram( alice, alice, core_sym::from_string("100.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), buyram( bob, bob, core_sym::from_string("100.0000") ) );
+
+   transaction trx;
+   set_transaction_headers( trx, 600 );
+   trx.actions.emplace_back( get_action( "eosio.token"_n, "transfer"_n, vector<permission_level>{{alice, config::active_name}},
+                                         mvo()("from", alice)("to", bob)("quantity", core_sym::from_string("1.0000"))("memo", "") ) );
+   const vector<permission_level> requested = { {alice, config::active_name} };
+   const permission_level alice_active{ alice, config::active_name };
+
+   measure( msig, "propose"_n, bob, mvo()("proposer", bob)("proposal_name", "first")("requested", requested)("trx", trx) );
+   measure( msig, "approve"_n, alice, mvo()("proposer", bob)("proposal_name", "first")("level", alice_active) );
+   measure( msig, "unapprove"_n, alice, mvo()("proposer", bob)("proposal_name", "first")("level", alice_active) );
+   base_tester::push_action( msig, "approve"_n, alice, mvo()("proposer", bob)("proposal_name", "first")("level", alice_active) );
+   produce_block();
+   measure( msig, "exec"_n, bob, mvo()("proposer", bob)("proposal_name", "first")("executer", bob) );
+
+   base_tester::push_action( msig, "propose"_n, bob, mvo()("proposer", bob)("proposal_name", "second")("requested", requested)("trx", trx) );
+   produce_block();
+   measure( msig, "cancel"_n, bob, mvo()("proposer", bob)("proposal_name", "second")("canceler", bob) );
+   measure( msig, "invalidate"_n, alice, mvo()("account", alice) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,458 @@
+#include "benchmark_tester.hpp"
+
+#include <fc/crypto/bls_private_key.hpp>
+
+#include <algorithm>
+
+using namespace eosio_system;
+
+// Every action of eosio.system is pushed here in its own transaction and its cost recorded. Actions that can
+// not be replayed on an initialized chain (`init`, `activate`, `onerror`, `canceldelay`) are not measured.
+
+BOOST_AUTO_TEST_SUITE(eosio_system_benchmarks)
+
+const name alice = "alice1111111"_n;
+const name bob   = "bob111111111"_n;
+const name carol = "carol1111111"_n;
+
+BOOST_FIXTURE_TEST_CASE( ram_actions, eosio_benchmark_tester ) try {
+   transfer( config::system_account_name, alice, core_sym::from_string("1000.0000") );
+
+   measure_system( "buyram"_n, alice, mvo()("payer", alice)("receiver", alice)("quant", core_sym::from_string("100.0000")) );
+   measure_system( "buyrambytes"_n, alice, mvo()("payer", alice)("receiver", bob)("bytes", 10000) );
+   measure_system( "buyramself"_n, alice, mvo()("account", alice)("quant", core_sym::from_string("10.0000")) );
+   measure_system( "sellram"_n, alice, mvo()("account", alice)("bytes", 1024) );
+   measure_system( "ramtransfer"_n, alice, mvo()("from", alice)("to", bob)("bytes", 1024)("memo", "") );
+   measure_system( "ramburn"_n, alice, mvo()("owner", alice)("bytes", 1024)("memo", "") );
+   measure_system( "buyramburn"_n, alice, mvo()("payer", alice)("quantity", core_sym::from_string("1.0000"))("memo", "") );
+   measure_system( "giftram"_n, alice, mvo()("from", alice)("to", bob)("bytes", 1024)("memo", "") );
+   measure_system( "ungiftram"_n, bob, mvo()("from", bob)("to", alice)("memo", "") );
+
+   // logging actions are normally only sent inline by the system contract itself
+   measure_system( "logbuyram"_n, config::system_account_name, mvo()("payer", alice)("receiver", alice)("quantity", core_sym::from_string("1.0000"))
+                                             ("bytes", 1000)("ram_bytes", 10000)("fee", core_sym::from_string("0.0050")) );
+   measure_system( "logsellram"_n, config::system_account_name, mvo()("account", alice)("quantity", core_sym::from_string("1.0000"))
+                                              ("bytes", 1000)("ram_bytes", 10000)("fee", core_sym::from_string("0.0050")) );
+   measure_system( "logramchange"_n, config::system_account_name, mvo()("owner", alice)("bytes", 1000)("ram_bytes", 10000) );
+   measure_system( "logsystemfee"_n, config::system_account_name, mvo()("protocol", config::system_account_name)("fee", core_sym::from_string("1.0000"))("memo", "") );
+
+   measure_system( "setram"_n, config::system_account_name, mvo()("max_ram_size", get_global_state()["max_ram_size"].as_uint64() + 1024 * 1024) );
+   measure_system( "setramrate"_n, config::system_account_name, mvo()("bytes_per_block", 1024) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( bandwidth_actions, eosio_benchmark_tester ) try {
+   const name unlimited = "unlimitedacc"_n;
+   create_accounts( { unlimited } );
+   transfer( config::system_account_name, alice, core_sym::from_string("1000.0000") );
+
+   measure_system( "delegatebw"_n, alice, mvo()("from", alice)("receiver", bob)
+                                                ("stake_net_quantity", core_sym::from_string("10.0000"))
+                                                ("stake_cpu_quantity", core_sym::from_string("10.0000"))
+                                                ("transfer", false) );
+   measure_system( "undelegatebw"_n, alice, mvo()("from", alice)("receiver", bob)
+                                                  ("unstake_net_quantity", core_sym::from_string("10.0000"))
+                                                  ("unstake_cpu_quantity", core_sym::from_string("10.0000")) );
+   produce_block( fc::days(3) );
+   produce_block();
+   measure_system( "refund"_n, alice, mvo()("owner", alice) );
+
+   measure_system( "setalimits"_n, config::system_account_name, mvo()("account", unlimited)("ram_bytes", 100000)("net_weight", 10)("cpu_weight", 10) );
+   measure_system( "setacctram"_n, config::system_account_name, mvo()("account", carol)("ram_bytes", 100000) );
+   measure_system( "setacctnet"_n, config::system_account_name, mvo()("account", carol)("net_weight", 100) );
+   measure_system( "setacctcpu"_n, config::system_account_name, mvo()("account", carol)("cpu_weight", 100) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( unvest_action, eosio_benchmark_tester ) try {
+   cross_15_percent_threshold();
+   produce_block( fc::days(14) );
+
+   const name b1 = "b1"_n;
+   issue_and_transfer( alice, core_sym::from_string("20000.0000"), config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), bidname( alice, b1, core_sym::from_string("1.0000") ) );
+   produce_block( fc::days(1) );
+   create_accounts_with_resources( { b1 }, alice );
+
+   const asset stake_amount = core_sym::from_string("50000000.0000");
+   issue_and_transfer( b1, stake_amount + stake_amount, config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( b1, b1, stake_amount, stake_amount ) );
+
+   measure_system( "unvest"_n, config::system_account_name, mvo()("account", b1)
+                                           ("unvest_net_quantity", core_sym::from_string("1.0000"))
+                                           ("unvest_cpu_quantity", core_sym::from_string("1.0000")) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( producer_and_voting_actions, eosio_benchmark_tester ) try {
+   auto producer_names = active_and_vote_producers();
+   const name newprod = "benchprod111"_n;
+   const name proxy   = "benchproxy11"_n;
+   const name voter   = "benchvoter11"_n;
+   setup_producer_accounts( { newprod, proxy, voter } );
+   transfer( config::system_account_name, voter, core_sym::from_string("1000.0000") );
+   BOOST_REQUIRE_EQUAL( success(), stake( voter, voter, core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+
+   measure_system( "regproducer"_n, newprod, mvo()("producer", newprod)
+                                                  ("producer_key", get_public_key( newprod, "active" ))
+                                                  ("url", "https://benchmark.example")
+                                                  ("location", 0) );
+   {
+      eosio::chain::block_signing_authority_v0 auth;
+      auth.threshold = 1;
+      auth.keys.push_back( {.key = get_public_key( newprod, "active" ), .weight = 1} );
+      producer_authority prod_auth = {.producer_name = newprod, .authority = auth};
+      measure_system( "regproducer2"_n, newprod, mvo()("producer", newprod)
+                                                       ("producer_authority", prod_auth.get_abi_variant()["authority"])
+                                                       ("url", "https://benchmark.example")
+                                                       ("location", 0) );
+   }
+
+   measure( "voteproducer.1", config::system_account_name, "voteproducer"_n, { voter },
+            mvo()("voter", voter)("proxy", name(0))("producers", vector<name>{ producer_names[0] }) );
+   measure( "voteproducer.21", config::system_account_name, "voteproducer"_n, { voter },
+            mvo()("voter", voter)("proxy", name(0))("producers", vector<name>( producer_names.begin(), producer_names.begin() + 21 )) );
+   // voteupdate refreshes the voter's REX stake first, which requires a REX balance
+   BOOST_REQUIRE_EQUAL( success(), deposit( voter, core_sym::from_string("10.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( voter, core_sym::from_string("10.0000") ) );
+   measure_system( "voteupdate"_n, voter, mvo()("voter_name", voter) );
+
+   measure_system( "regproxy"_n, proxy, mvo()("proxy", proxy)("isproxy", true) );
+   measure( "voteproducer.proxy", config::system_account_name, "voteproducer"_n, { voter },
+            mvo()("voter", voter)("proxy", proxy)("producers", vector<name>{}) );
+   // stake2vote of both the voter and the proxy
+   measure( "voteupdate.proxied", config::system_account_name, "voteupdate"_n, { voter }, mvo()("voter_name", voter) );
+
+   // a full 30 producer vote, cast again unchanged and then shifted by one producer
+   {
+      std::vector<name> more_producers;
+      for( uint32_t i = 0; producer_names.size() + more_producers.size() < 31; ++i ) {
+         more_producers.push_back( name( "benchprodx" + std::string( 1, char('a' + i) ) ) );
+      }
+      setup_producer_accounts( more_producers );
+      for( const auto& p : more_producers ) {
+         BOOST_REQUIRE_EQUAL( success(), regproducer( p ) );
+      }
+      std::vector<name> all_producers = producer_names;
+      all_producers.insert( all_producers.end(), more_producers.begin(), more_producers.end() );
+      std::sort( all_producers.begin(), all_producers.end() );
+      const std::vector<name> first_30( all_producers.begin(), all_producers.begin() + 30 );
+      const std::vector<name> last_30( all_producers.begin() + 1, all_producers.begin() + 31 );
+      measure( "voteproducer.30", config::system_account_name, "voteproducer"_n, { voter },
+               mvo()("voter", voter)("proxy", name(0))("producers", first_30) );
+      measure( "voteproducer.30.unchanged", config::system_account_name, "voteproducer"_n, { voter },
+               mvo()("voter", voter)("proxy", name(0))("producers", first_30) );
+      measure( "voteproducer.30.shifted", config::system_account_name, "voteproducer"_n, { voter },
+               mvo()("voter", voter)("proxy", name(0))("producers", last_30) );
+
+      // three REX holding voters refreshed at once, with 29 of their 30 producers in common
+      const std::vector<name> more_voters = { "benchvoter12"_n, "benchvoter13"_n };
+      setup_producer_accounts( more_voters );
+      for( const auto& v : more_voters ) {
+         transfer( config::system_account_name, v, core_sym::from_string("1000.0000") );
+         BOOST_REQUIRE_EQUAL( success(), stake( v, v, core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+         BOOST_REQUIRE_EQUAL( success(), deposit( v, core_sym::from_string("10.0000") ) );
+         BOOST_REQUIRE_EQUAL( success(), buyrex( v, core_sym::from_string("10.0000") ) );
+         BOOST_REQUIRE_EQUAL( success(), vote( v, first_30 ) );
+      }
+      measure( "voteupdates.3", config::system_account_name, "voteupdates"_n, { voter, more_voters[0], more_voters[1] },
+               mvo()("voter_names", vector<name>{ voter, more_voters[0], more_voters[1] }) );
+
+      // once vote sets are enabled, a changed vote is stored in a shared vote set
+      measure_system( "cfgvotesets"_n, config::system_account_name, mvo()("enabled", true) );
+      measure( "voteproducer.30.vote_set", config::system_account_name, "voteproducer"_n, { voter },
+               mvo()("voter", voter)("proxy", name(0))("producers", first_30) );
+   }
+   // the ranking of the 31 registered producers
+   measure_system( "getranking"_n, alice, mvo() );
+
+   measure_system( "unregprod"_n, newprod, mvo()("producer", newprod) );
+   measure_system( "rmvproducer"_n, config::system_account_name, mvo()("producer", producer_names[20]) );
+
+   // a full round has passed in active_and_vote_producers, so claimrewards pays out
+   produce_block( fc::hours(24) );
+   measure_system( "claimrewards"_n, producer_names[0], mvo()("owner", producer_names[0]) );
+
+   measure_onblock( "onblock" );
+   measure_onblock( "onblock.after_gap", fc::minutes(2) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( deferred_vote_tally, eosio_benchmark_tester ) try {
+   auto producer_names = active_and_vote_producers();
+   const name voter = "benchvoter11"_n;
+   setup_producer_accounts( { voter } );
+   transfer( config::system_account_name, voter, core_sym::from_string("1000.0000") );
+   BOOST_REQUIRE_EQUAL( success(), stake( voter, voter, core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+
+   measure( "cfgvotetally.enable", config::system_account_name, "cfgvotetally"_n, { config::system_account_name },
+            mvo()("deferred", true) );
+   measure( "voteproducer.21.deferred_tally", config::system_account_name, "voteproducer"_n, { voter },
+            mvo()("voter", voter)("proxy", name(0))("producers", vector<name>( producer_names.begin(), producer_names.begin() + 21 )) );
+   // the next producer election applies the tallied changes of the 21 producers
+   measure_onblock( "onblock.flush_vote_tally", fc::minutes(2) );
+
+   measure( "voteproducer.1.deferred_tally", config::system_account_name, "voteproducer"_n, { voter },
+            mvo()("voter", voter)("proxy", name(0))("producers", vector<name>{ producer_names[0] }) );
+   // disabling applies the changes still tallied
+   measure( "cfgvotetally.disable", config::system_account_name, "cfgvotetally"_n, { config::system_account_name },
+            mvo()("deferred", false) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( finalizer_and_peer_key_actions, eosio_benchmark_tester ) try {
+   auto producer_names = active_and_vote_producers();
+
+   std::vector<fc::crypto::blslib::bls_private_key> keys;
+   for( size_t i = 0; i <= producer_names.size(); ++i ) {
+      keys.emplace_back( fc::crypto::blslib::bls_private_key::generate() );
+   }
+   auto regfinkey = [&]( const name& p, const fc::crypto::blslib::bls_private_key& k ) {
+      return mvo()("finalizer_name", p)
+                  ("finalizer_key", k.get_public_key().to_string())
+                  ("proof_of_possession", k.proof_of_possession().to_string());
+   };
+
+   measure_system( "regfinkey"_n, producer_names[0], regfinkey( producer_names[0], keys[0] ) );
+   for( size_t i = 1; i < producer_names.size(); ++i ) {
+      BOOST_REQUIRE_EQUAL( success(), push_action( producer_names[i], "regfinkey"_n, regfinkey( producer_names[i], keys[i] ) ) );
+   }
+   const auto& spare = keys.back();
+   BOOST_REQUIRE_EQUAL( success(), push_action( producer_names[0], "regfinkey"_n, regfinkey( producer_names[0], spare ) ) );
+   measure_system( "actfinkey"_n, producer_names[0], mvo()("finalizer_name", producer_names[0])
+                                                           ("finalizer_key", spare.get_public_key().to_string()) );
+   measure_system( "delfinkey"_n, producer_names[0], mvo()("finalizer_name", producer_names[0])
+                                                           ("finalizer_key", keys[0].get_public_key().to_string()) );
+   measure_system( "switchtosvnn"_n, config::system_account_name, mvo() );
+
+   measure_system( "regpeerkey"_n, producer_names[0], mvo()("proposer_finalizer_name", producer_names[0])
+                                                            ("key", get_public_key( producer_names[0], "peer" )) );
+   measure_system( "getpeerkeys"_n, alice, mvo() );
+   measure_system( "delpeerkey"_n, producer_names[0], mvo()("proposer_finalizer_name", producer_names[0])
+                                                            ("key", get_public_key( producer_names[0], "peer" )) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( rex_actions, eosio_benchmark_tester ) try {
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n };
+   const name rex_alice = accounts[0], rex_bob = accounts[1], rex_carol = accounts[2];
+   setup_rex_accounts( accounts, core_sym::from_string("40000.0000") );
+
+   measure_system( "withdraw"_n, rex_carol, mvo()("owner", rex_carol)("amount", core_sym::from_string("1.0000")) );
+   measure_system( "deposit"_n, rex_carol, mvo()("owner", rex_carol)("amount", core_sym::from_string("1.0000")) );
+   measure_system( "buyrex"_n, rex_alice, mvo()("from", rex_alice)("amount", core_sym::from_string("30000.0000")) );
+   measure_system( "unstaketorex"_n, rex_bob, mvo()("owner", rex_bob)("receiver", rex_bob)
+                                                    ("from_net", core_sym::from_string("5.0000"))
+                                                    ("from_cpu", core_sym::from_string("5.0000")) );
+
+   measure_system( "rentcpu"_n, rex_bob, mvo()("from", rex_bob)("receiver", rex_carol)
+                                              ("loan_payment", core_sym::from_string("7.0000"))("loan_fund", core_sym::from_string("1.0000")) );
+   measure_system( "rentnet"_n, rex_bob, mvo()("from", rex_bob)("receiver", rex_carol)
+                                              ("loan_payment", core_sym::from_string("7.0000"))("loan_fund", core_sym::from_string("1.0000")) );
+   const uint64_t cpu_loan = get_last_cpu_loan()["loan_num"].as_uint64();
+   const uint64_t net_loan = get_last_net_loan()["loan_num"].as_uint64();
+   measure_system( "fundcpuloan"_n, rex_bob, mvo()("from", rex_bob)("loan_num", cpu_loan)("payment", core_sym::from_string("1.0000")) );
+   measure_system( "fundnetloan"_n, rex_bob, mvo()("from", rex_bob)("loan_num", net_loan)("payment", core_sym::from_string("1.0000")) );
+   measure_system( "defcpuloan"_n, rex_bob, mvo()("from", rex_bob)("loan_num", cpu_loan)("amount", core_sym::from_string("0.5000")) );
+   measure_system( "defnetloan"_n, rex_bob, mvo()("from", rex_bob)("loan_num", net_loan)("amount", core_sym::from_string("0.5000")) );
+
+   measure_system( "donatetorex"_n, config::system_account_name, mvo()("payer", config::system_account_name)("quantity", core_sym::from_string("10.0000"))("memo", "") );
+   measure_system( "mvtosavings"_n, rex_alice, mvo()("owner", rex_alice)("rex", asset::from_string("1000.0000 REX")) );
+   measure_system( "mvfrsavings"_n, rex_alice, mvo()("owner", rex_alice)("rex", asset::from_string("1000.0000 REX")) );
+   measure_system( "consolidate"_n, rex_alice, mvo()("owner", rex_alice) );
+
+   produce_block( fc::days(5) );
+   produce_blocks( 2 );
+   // the loan fees are not distributed yet, so the quote advances a copy of the return pool
+   measure_read_only( "rexquote", config::system_account_name, "rexquote"_n, mvo()("owner", rex_alice)
+                                                                                ("payment", core_sym::from_string("100.0000"))
+                                                                                ("rex", asset::from_string("1000.0000 REX"))
+                                                                                ("loan_payment", core_sym::from_string("10.0000")) );
+   measure_system( "updaterex"_n, rex_alice, mvo()("owner", rex_alice) );
+
+   // most of the pool is lent out, so selling everything queues an order
+   measure( "sellrex.queued", config::system_account_name, "sellrex"_n, { rex_alice }, mvo()("from", rex_alice)("rex", get_rex_balance( rex_alice )) );
+   measure_system( "cnclrexorder"_n, rex_alice, mvo()("owner", rex_alice) );
+   measure( "sellrex.filled", config::system_account_name, "sellrex"_n, { rex_alice }, mvo()("from", rex_alice)("rex", asset::from_string("1.0000 REX")) );
+   BOOST_REQUIRE_EQUAL( success(), sellrex( rex_alice, get_rex_balance( rex_alice ) ) );
+
+   produce_block( fc::days(26) );
+   produce_blocks( 2 );
+   measure_system( "rexexec"_n, rex_carol, mvo()("user", rex_carol)("max", 2) );
+
+   BOOST_REQUIRE_EQUAL( success(), sellrex( rex_bob, get_rex_balance( rex_bob ) ) );
+   BOOST_REQUIRE_EQUAL( success(), withdraw( rex_bob, get_rex_fund( rex_bob ) ) );
+   measure_system( "closerex"_n, rex_bob, mvo()("owner", rex_bob) );
+
+   measure_system( "setrexmature"_n, config::system_account_name, mvo()("num_of_maturity_buckets", 5)("sell_matured_rex", true)("buy_rex_to_savings", false) );
+   measure_system( "setrex"_n, config::system_account_name, mvo()("balance", core_sym::from_string("20000.0000")) );
+} FC_LOG_AND_RETHROW()
+
+// update_rex_pool catching up after a quiet period, with every return bucket of the 30-day window expiring at once
+BOOST_FIXTURE_TEST_CASE( rex_return_pool_catch_up, eosio_benchmark_tester ) try {
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+   const name rex_alice = accounts[0], rex_bob = accounts[1];
+   setup_rex_accounts( accounts, core_sym::from_string("1000.0000") );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( rex_alice, core_sym::from_string("500.0000") ) );
+
+   // one donation per 12-hour bucket fills the window with the largest possible number of return buckets
+   for( uint32_t i = 0; i < 61; ++i ) {
+      BOOST_REQUIRE_EQUAL( success(), donatetorex( config::system_account_name, core_sym::from_string("10.0000"), "" ) );
+      produce_block( fc::hours(12) );
+   }
+   measure( "rexexec.return_bucket", config::system_account_name, "rexexec"_n, { rex_bob }, mvo()("user", rex_bob)("max", 2) );
+
+   produce_block( fc::days(31) );
+   produce_blocks( 2 );
+   measure( "rexexec.after_gap", config::system_account_name, "rexexec"_n, { rex_bob }, mvo()("user", rex_bob)("max", 2) );
+} FC_LOG_AND_RETHROW()
+
+// two sellrex orders filled by one runrex batch and reported by a single orderresults action
+BOOST_FIXTURE_TEST_CASE( rex_aggregated_order_results, eosio_benchmark_tester ) try {
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n, "emilyaccount"_n };
+   const name rex_alice = accounts[0], rex_bob = accounts[1], rex_carol = accounts[2], rex_emily = accounts[3];
+   setup_rex_accounts( accounts, core_sym::from_string("3000000.0000") );
+
+   measure_system( "cfgrexresult"_n, config::system_account_name, mvo()("aggregate", true) );
+
+   BOOST_REQUIRE_EQUAL( success(), buyrex( rex_alice, core_sym::from_string("50000.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( rex_bob,   core_sym::from_string("105500.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( rex_carol, core_sym::from_string("104500.0000") ) );
+   for( uint8_t i = 0; i < 4; ++i ) {
+      BOOST_REQUIRE_EQUAL( success(), rentcpu( rex_emily, rex_emily, core_sym::from_string("12000.0000") ) );
+   }
+
+   // most of the pool is lent out, so both orders are queued until the loans expire
+   produce_block( fc::days(6) );
+   BOOST_REQUIRE_EQUAL( success(), sellrex( rex_bob,   get_rex_balance( rex_bob ) ) );
+   BOOST_REQUIRE_EQUAL( success(), sellrex( rex_carol, get_rex_balance( rex_carol ) ) );
+   produce_block( fc::days(25) );
+   measure( "rexexec.orderresults", config::system_account_name, "rexexec"_n, { rex_alice }, mvo()("user", rex_alice)("max", 4) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( powerup_actions, eosio_benchmark_tester ) try {
+   create_accounts_with_resources( { "eosio.reserv"_n } );
+   transfer( config::system_account_name, alice, core_sym::from_string("1000.0000") );
+
+   auto resource = [&]() {
+      return mvo()("current_weight_ratio", 1'000'000'000'000'000ll)
+                  ("target_weight_ratio", 10'000'000'000'000ll)
+                  ("assumed_stake_weight", 100'000'000'0000ll)
+                  ("target_timestamp", time_point_sec( control->pending_block_time() + fc::days(100) ))
+                  ("exponent", 2)
+                  ("decay_secs", fc::days(1).to_seconds())
+                  ("min_price", core_sym::from_string("0.0000"))
+                  ("max_price", core_sym::from_string("1000000.0000"));
+   };
+   measure_system( "cfgpowerup"_n, config::system_account_name, mvo()("args", mvo()("net", resource())
+                                                               ("cpu", resource())
+                                                               ("powerup_days", 30)
+                                                               ("min_powerup_fee", core_sym::from_string("0.0001"))) );
+   measure_system( "powerup"_n, alice, mvo()("payer", alice)("receiver", bob)("days", 30)
+                                            ("net_frac", 1'000'000'000'000ll)("cpu_frac", 1'000'000'000'000ll)
+                                            ("max_payment", core_sym::from_string("1000.0000")) );
+   produce_block( fc::days(31) );
+   measure_system( "powerupexec"_n, alice, mvo()("user", alice)("max", 10) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( name_bidding_actions, eosio_benchmark_tester ) try {
+   cross_15_percent_threshold();
+   produce_block( fc::days(14) );
+   produce_block();
+   transfer( config::system_account_name, alice, core_sym::from_string("1000.0000") );
+   transfer( config::system_account_name, bob, core_sym::from_string("1000.0000") );
+
+   measure_system( "bidname"_n, alice, mvo()("bidder", alice)("newname", "prefa")("bid", core_sym::from_string("1.0000")) );
+   BOOST_REQUIRE_EQUAL( success(), bidname( bob, "prefa"_n, core_sym::from_string("2.0000") ) );
+   measure_system( "bidrefund"_n, alice, mvo()("bidder", alice)("newname", "prefa") );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( governance_actions, eosio_benchmark_tester ) try {
+   measure_system( "setpriv"_n, config::system_account_name, mvo()("account", alice)("is_priv", 0) );
+   measure_system( "setparams"_n, config::system_account_name, mvo()("params", control->get_global_properties().configuration) );
+   measure_system( "wasmcfg"_n, config::system_account_name, mvo()("settings", "high") );
+   measure_system( "updtrevision"_n, config::system_account_name, mvo()("revision", 1) );
+
+   measure_system( "setinflation"_n, config::system_account_name, mvo()("annual_rate", 500)("inflation_pay_factor", 50000)("votepay_factor", 40000) );
+   measure_system( "setpayfactor"_n, config::system_account_name, mvo()("inflation_pay_factor", 50000)("votepay_factor", 40000) );
+   const time_point_sec start = time_point_sec( control->pending_block_time() );
+   measure_system( "setschedule"_n, config::system_account_name, mvo()("start_time", start)("continuous_rate", 0.05) );
+   measure_system( "delschedule"_n, config::system_account_name, mvo()("start_time", start) );
+   BOOST_REQUIRE_EQUAL( success(), setschedule( start, 0.05 ) );
+   measure_system( "execschedule"_n, alice, mvo() );
+
+   const std::vector<name> patterns = { "bad"_n, "worse"_n };
+   measure_system( "denyhashcalc"_n, alice, mvo()("patterns", patterns) );
+   measure_system( "denyhashadd"_n, config::system_account_name, mvo()("hash", *denyhashcalc( config::system_account_name, patterns )) );
+   measure_system( "denynames"_n, config::system_account_name, mvo()("patterns", patterns) );
+   measure_system( "undenynames"_n, config::system_account_name, mvo()("patterns", patterns) );
+   BOOST_REQUIRE_EQUAL( success(), denyhashadd( config::system_account_name, *denyhashcalc( config::system_account_name, { "other"_n } ) ) );
+   measure_system( "denyhashrm"_n, config::system_account_name, mvo()("hash", *denyhashcalc( config::system_account_name, { "other"_n } )) );
+
+   measure_system( "limitauthchg"_n, alice, mvo()("account", alice)("allow_perms", vector<name>{ "owner"_n })("disallow_perms", vector<name>{}) );
+} FC_LOG_AND_RETHROW()
+
+// onblock overwriting one blockinfo record, at the default and at the largest rolling window, and setblockinfo
+// moving every record of the largest window
+BOOST_FIXTURE_TEST_CASE( blockinfo_actions, eosio_benchmark_tester ) try {
+   measure_onblock( "onblock.blockinfo" );
+   measure( "setblockinfo.grow", config::system_account_name, "setblockinfo"_n, { config::system_account_name },
+            mvo()("rolling_window_size", 1200) );
+   produce_blocks( 1200 );
+   measure_onblock( "onblock.blockinfo.max_window" );
+   measure( "setblockinfo.shrink", config::system_account_name, "setblockinfo"_n, { config::system_account_name },
+            mvo()("rolling_window_size", 10) );
+} FC_LOG_AND_RETHROW()
+
+// onblock reading and writing the four legacy global rows, the consolidated row while still mirroring them,
+// and the consolidated row alone
+BOOST_FIXTURE_TEST_CASE( global_state_merge, eosio_benchmark_tester ) try {
+   measure_onblock( "onblock.legacy_globals" );
+   measure_system( "mergeglobals"_n, config::system_account_name, mvo()("mirror_legacy", true) );
+   measure_onblock( "onblock.merged_globals.mirrored" );
+   measure( "mergeglobals.drop_legacy", config::system_account_name, "mergeglobals"_n, { config::system_account_name },
+            mvo()("mirror_legacy", false) );
+   measure_onblock( "onblock.merged_globals" );
+   measure( "mergeglobals.restore_legacy", config::system_account_name, "mergeglobals"_n, { config::system_account_name },
+            mvo()("mirror_legacy", true) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( native_actions, eosio_benchmark_tester ) try {
+   {
+      // the common account creation transaction: newaccount + buyram + delegatebw
+      const name a = "benchaccount"_n;
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{config::system_account_name, config::active_name}},
+                                newaccount{ .creator = config::system_account_name,
+                                            .name    = a,
+                                            .owner   = authority( get_public_key( a, "owner" ) ),
+                                            .active  = authority( get_public_key( a, "active" ) ) } );
+      trx.actions.emplace_back( get_action( config::system_account_name, "buyrambytes"_n, vector<permission_level>{{config::system_account_name, config::active_name}},
+                                            mvo()("payer", config::system_account_name)("receiver", a)("bytes", 8192) ) );
+      trx.actions.emplace_back( get_action( config::system_account_name, "delegatebw"_n, vector<permission_level>{{config::system_account_name, config::active_name}},
+                                            mvo()("from", config::system_account_name)("receiver", a)
+                                                 ("stake_net_quantity", core_sym::from_string("1.0000"))
+                                                 ("stake_cpu_quantity", core_sym::from_string("1.0000"))
+                                                 ("transfer", true) ) );
+      measure_trx( "newaccount", config::system_account_name, trx, { config::system_account_name } );
+   }
+
+   measure_system( "updateauth"_n, alice, mvo()("account", alice)("permission", "bench")("parent", "active")
+                                               ("auth", authority( get_public_key( alice, "bench" ) )) );
+   measure_system( "linkauth"_n, alice, mvo()("account", alice)("code", "eosio.token")("type", "transfer")("requirement", "bench") );
+   measure_system( "unlinkauth"_n, alice, mvo()("account", alice)("code", "eosio.token")("type", "transfer") );
+   measure_system( "deleteauth"_n, alice, mvo()("account", alice)("permission", "bench") );
+
+   transfer( config::system_account_name, alice, core_sym::from_string("1000.0000") );
+   BOOST_REQUIRE_EQUAL( success(), buyram( alice, alice, core_sym::from_string("500.0000") ) );
+   {
+      const auto wasm = contracts::token_wasm();
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{alice, config::active_name}},
+                                setcode{ .account = alice, .vmtype = 0, .vmversion = 0, .code = bytes( wasm.begin(), wasm.end() ) } );
+      measure_trx( "setcode", config::system_account_name, trx, { alice } );
+   }
+   {
+      const auto abi = contracts::token_abi();
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{alice, config::active_name}},
+                                setabi{ .account = alice, .abi = bytes( abi.begin(), abi.end() ) } );
+      measure_trx( "setabi", config::system_account_name, trx, { alice } );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,42 @@
+#include "mainnet_state_tester.hpp"
+
+using namespace eosio_system;
+
+// Measures the hot paths whose cost grows with table size against mainnet-shaped state.
+// Populating the state takes a while at the default scale; pass `-- --bench-scale=0.01` for a quick run.
+BOOST_AUTO_TEST_SUITE(eosio_system_mainnet_benchmarks)
+
+BOOST_FIXTURE_TEST_CASE( mainnet_scale_hot_paths, mainnet_state_tester ) try {
+   const auto tag = shape.tag();
+   const name proxied_voter = voter( 0 );
+   BOOST_REQUIRE( is_proxied( 0 ) );
+
+   measure_onblock( "onblock" + tag );
+   measure_onblock( "onblock.update_elected_producers" + tag, fc::seconds(61) );
+
+   // propagate_weight_change: stake change of a proxied voter, re-vote of a proxy and a voter switching proxies
+   measure_as( "delegatebw.proxied_voter", config::system_account_name, "delegatebw"_n, proxied_voter,
+               mvo()("from", proxied_voter)("receiver", proxied_voter)("stake_net_quantity", core_sym::from_string("1.0000"))
+                    ("stake_cpu_quantity", core_sym::from_string("1.0000"))("transfer", 0) );
+   measure_as( "voteproducer.proxy", config::system_account_name, "voteproducer"_n, proxy( 0 ),
+               mvo()("voter", proxy( 0 ))("proxy", name())("producers", producer_window( 1 )) );
+   measure_as( "voteproducer.switch_proxy", config::system_account_name, "voteproducer"_n, proxied_voter,
+               mvo()("voter", proxied_voter)("proxy", proxy( 1 % shape.proxies ))("producers", vector<name>()) );
+   measure_as( "voteupdate.proxied_voter", config::system_account_name, "voteupdate"_n, proxied_voter,
+               mvo()("voter_name", proxied_voter) );
+
+   // bpay::on_transfer walks the `prototalvote` index
+   const name fees = "eosio.fees"_n;
+   transfer( config::system_account_name, fees, core_sym::from_string("1000.0000"), config::system_account_name );
+   measure( "on_transfer" + tag, "eosio.token"_n, "transfer"_n, { fees },
+            mvo()("from", fees)("to", "eosio.bpay"_n)("quantity", core_sym::from_string("1000.0000"))("memo", "") );
+
+   // once loans and powerup orders have expired, the next schedule update also closes the highest name bid
+   measure_onblock( "onblock.name_close" + tag, fc::days(powerup_days + 1) );
+
+   // runrex and process_powerup_queue on a full queue of expired entries
+   measure_as( "rexexec", config::system_account_name, "rexexec"_n, whale, mvo()("user", whale)("max", 100) );
+   measure_as( "powerupexec", config::system_account_name, "powerupexec"_n, whale, mvo()("user", whale)("max", 100) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
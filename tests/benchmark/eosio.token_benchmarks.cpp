@@ -0,0 +1,31 @@
+#include "benchmark_tester.hpp"
+
+using namespace eosio_system;
+
+BOOST_AUTO_TEST_SUITE(eosio_token_benchmarks)
+
+const name alice = "alice1111111"_n;
+const name bob   = "bob111111111"_n;
+const name token = "eosio.token"_n;
+
+BOOST_FIXTURE_TEST_CASE( token_actions, eosio_benchmark_tester ) try {
+   const asset max_supply = asset::from_string("1000000.0000 BENCH");
+
+   measure( token, "create"_n, token, mvo()("issuer", alice)("maximum_supply", max_supply) );
+   measure( token, "issue"_n, alice, mvo()("to", alice)("quantity", asset::from_string("1000.0000 BENCH"))("memo", "") );
+   measure( token, "issuefixed"_n, alice, mvo()("to", alice)("supply", asset::from_string("2000.0000 BENCH"))("memo", "") );
+   measure( token, "setmaxsupply"_n, alice, mvo()("issuer", alice)("maximum_supply", asset::from_string("500000.0000 BENCH")) );
+   measure( token, "retire"_n, alice, mvo()("quantity", asset::from_string("10.0000 BENCH"))("memo", "") );
+
+   measure( "transfer.new_balance", token, "transfer"_n, { alice },
+            mvo()("from", alice)("to", bob)("quantity", asset::from_string("1.0000 BENCH"))("memo", "") );
+   measure( "transfer", token, "transfer"_n, { alice },
+            mvo()("from", alice)("to", bob)("quantity", asset::from_string("1.0000 BENCH"))("memo", "") );
+   measure( "transfer.core", token, "transfer"_n, { config::system_account_name },
+            mvo()("from", config::system_account_name)("to", bob)("quantity", core_sym::from_string("1.0000"))("memo", "") );
+
+   measure( token, "open"_n, alice, mvo()("owner", "carol1111111")("symbol", "4,BENCH")("ram_payer", alice) );
+   measure( token, "close"_n, "carol1111111"_n, mvo()("owner", "carol1111111")("symbol", "4,BENCH") );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,33 @@
+#include "benchmark_tester.hpp"
+
+using namespace eosio_system;
+
+BOOST_AUTO_TEST_SUITE(eosio_wrap_benchmarks)
+
+const name alice = "alice1111111"_n;
+const name bob   = "bob111111111"_n;
+const name wrap  = "eosio.wrap"_n;
+
+BOOST_FIXTURE_TEST_CASE( wrap_actions, eosio_benchmark_tester ) try {
+   create_account_with_resources( wrap, config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), buyram( config::system_account_name, wrap, core_sym::from_string("5000.0000") ) );
+   base_tester::push_action( config::system_account_name, "setpriv"_n, config::system_account_name,
+                             mvo()("account", wrap)("is_priv", 1) );
+   set_code( wrap, contracts::wrap_wasm() );
+   set_abi( wrap, contracts::wrap_abi().data() );
+   produce_blocks();
+   transfer( config::system_account_name, bob, core_sym::from_string("10.0000") );
+
+   transaction inner;
+   set_transaction_headers( inner );
+   inner.actions.emplace_back( get_action( "eosio.token"_n, "transfer"_n, vector<permission_level>{{bob, config::active_name}},
+                                           mvo()("from", bob)("to", alice)("quantity", core_sym::from_string("1.0000"))("memo", "") ) );
+
+   signed_transaction trx;
+   trx.actions.emplace_back( get_action( wrap, "exec"_n,
+                                         vector<permission_level>{{alice, config::active_name}, {wrap, config::active_name}},
+                                         mvo()("executer", alice)("trx", inner) ) );
+   measure_trx( "exec", wrap, trx, { alice, wrap } );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
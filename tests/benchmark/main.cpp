@@ -0,0 +1,48 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <boost/test/included/unit_test.hpp>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include "benchmark_tester.hpp"
+
+using namespace eosio_system;
+#define BOOST_TEST_STATIC_LINK
+
+void translate_fc_exception(const fc::exception &e) {
+   std::cerr << "\033[33m" <<  e.to_detail_string() << "\033[0m" << std::endl;
+   BOOST_TEST_FAIL("Caught Unexpected Exception");
+}
+
+// Writes the collected measurements once every selected benchmark suite has run
+struct benchmark_report {
+   ~benchmark_report() { benchmark_recorder::instance().write(); }
+};
+BOOST_TEST_GLOBAL_FIXTURE(benchmark_report);
+
+boost::unit_test::test_suite* init_unit_test_suite(int argc, char* argv[]) {
+   // Turn off blockchain logging if no --verbose parameter is not added
+   // To have verbose enabled, call "tests/benchmark -- --verbose"
+   bool is_verbose = false;
+   std::string verbose_arg = "--verbose";
+   for (int i = 0; i < argc; i++) {
+      if (verbose_arg == argv[i]) {
+         is_verbose = true;
+         break;
+      }
+   }
+
+   if(is_verbose) {
+      fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::debug);
+   } else {
+      fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::off);
+   }
+
+   benchmark_recorder::instance().configure(argc, argv);
+
+   // Register fc::exception translator
+   boost::unit_test::unit_test_monitor.template register_exception_translator<fc::exception>(&translate_fc_exception);
+
+   return nullptr;
+}
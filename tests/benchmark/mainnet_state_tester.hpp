@@ -0,0 +1,242 @@
+#pragma once
+
+#include "benchmark_tester.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eosio_system {
+
+// Amount of state populated by mainnet_state_tester. The defaults roughly follow the shape of EOS mainnet;
+// every count is multiplied by --bench-scale so the same fixture can be used for quick runs.
+struct mainnet_shape {
+   uint32_t producers      = 500;
+   uint32_t proxies        = 500;
+   uint32_t voters         = 100'000;
+   uint32_t proxied_pct    = 40;        // share of the voters delegating their vote to a proxy
+   uint32_t rex_holders    = 20'000;    // rexbal rows
+   uint32_t loans          = 20'000;    // cpuloan and netloan rows, split evenly
+   uint32_t powerup_orders = 20'000;    // powup.order rows
+   uint32_t name_bids      = 10'000;    // namebids rows
+
+   mainnet_shape scaled( double factor ) const {
+      auto scale = [&]( uint32_t count, uint32_t min ) {
+         return std::max( min, static_cast<uint32_t>( std::llround( count * factor ) ) );
+      };
+      mainnet_shape s = *this;
+      s.producers      = scale( producers, 30 );
+      s.proxies        = scale( proxies, 1 );
+      s.voters         = scale( voters, 100 );
+      s.rex_holders    = std::min( s.voters, scale( rex_holders, 1 ) );
+      s.loans          = std::min( s.voters, scale( loans, 2 ) );
+      s.powerup_orders = std::min( s.voters, scale( powerup_orders, 1 ) );
+      s.name_bids      = std::min( s.voters, scale( name_bids, 1 ) );
+      return s;
+   }
+
+   // Suffix appended to benchmark labels so that measurements taken at different scales are never compared
+   std::string tag() const { return "@" + std::to_string( voters ) + "_voters"; }
+};
+
+// Benchmark fixture that fills the system contract tables with mainnet-shaped state before anything is measured:
+//   - `producers` / `producers2`: registered producers, ordered by index
+//   - `voters`: proxies voting for 30 producers each and voters either voting for 30 of the most popular producers
+//     or delegating to a proxy (a proxy cannot use a proxy itself, so chains are voter -> proxy -> producers)
+//   - `rexbal`, `rexfund`, `cpuloan`, `netloan`, `powup.order` and `namebids`: one row per participating voter
+//
+// Generated accounts are controlled by eosio@active so a whole batch can be pushed in a single transaction signed
+// with one key; use measure_as() to measure actions authorized by them.
+class mainnet_state_tester : public eosio_benchmark_tester {
+public:
+   static constexpr uint32_t batch_size     = 25;
+   static constexpr uint32_t votes_per_voter = 30;
+   static constexpr uint32_t powerup_days   = 30;
+
+   const name whale   = "benchwhale11"_n;
+   const name reserve = "eosio.reserv"_n;
+
+   mainnet_state_tester() : shape( mainnet_shape{}.scaled( benchmark_recorder::instance().scale_factor() ) ) {
+      populate();
+   }
+
+   // 12 character account names whose suffix encodes `index`, so that name order follows index order
+   static name indexed_name( const std::string& prefix, uint32_t index, size_t length = 12 ) {
+      static const char digits[] = "12345abcdefghijklmnopqrstuvwxyz";
+      std::string suffix( length - prefix.size(), '1' );
+      for( auto it = suffix.rbegin(); it != suffix.rend() && index; ++it, index /= 31 ) {
+         *it = digits[index % 31];
+      }
+      return name( prefix + suffix );
+   }
+
+   name producer( uint32_t i ) const { return indexed_name( "benchp", i ); }
+   name proxy( uint32_t i ) const    { return indexed_name( "benchx", i ); }
+   name voter( uint32_t i ) const    { return indexed_name( "benchv", i ); }
+   name bid_name( uint32_t i ) const { return indexed_name( "bn", i, 8 ); }
+
+   bool is_proxied( uint32_t voter_index ) const { return voter_index % 100 < shape.proxied_pct; }
+
+   // `votes_per_voter` consecutive producers starting at `first`, wrapping around, sorted as voteproducer expects
+   std::vector<name> producer_window( uint32_t first ) const {
+      std::vector<name> result;
+      for( uint32_t i = 0; i < std::min( votes_per_voter, shape.producers ); ++i ) {
+         result.push_back( producer( (first + i) % shape.producers ) );
+      }
+      std::sort( result.begin(), result.end() );
+      return result;
+   }
+
+   // Measures a single action authorized by one of the generated accounts
+   transaction_trace_ptr measure_as( const std::string& label, const account_name& contract, const action_name& act,
+                                     const account_name& actor, const variant_object& data ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( get_action( contract, act, vector<permission_level>{{actor, config::active_name}}, data ) );
+      return measure_trx( label + shape.tag(), contract, trx, { config::system_account_name } );
+   }
+
+   const mainnet_shape shape;
+
+private:
+   action system_action( const action_name& act, const account_name& actor, const variant_object& data ) {
+      return get_action( config::system_account_name, act, vector<permission_level>{{actor, config::active_name}}, data );
+   }
+
+   action token_transfer( const account_name& from, const account_name& to, const asset& quantity ) {
+      return get_action( "eosio.token"_n, "transfer"_n, vector<permission_level>{{from, config::active_name}},
+                         mvo()("from", from)("to", to)("quantity", quantity)("memo", "") );
+   }
+
+   // newaccount + RAM + stake transferred to the new account + liquid balance
+   void append_account( std::vector<action>& batch, const name& a, const asset& stake, const asset& liquid ) {
+      const name creator = config::system_account_name;
+      const authority auth( 1, {}, { permission_level_weight{{creator, config::active_name}, 1} } );
+      batch.emplace_back( vector<permission_level>{{creator, config::active_name}},
+                          newaccount{ .creator = creator, .name = a, .owner = auth, .active = auth } );
+      batch.emplace_back( system_action( "buyrambytes"_n, creator, mvo()("payer", creator)("receiver", a)("bytes", 8192) ) );
+      batch.emplace_back( system_action( "delegatebw"_n, creator, mvo()("from", creator)("receiver", a)
+                                                                       ("stake_net_quantity", stake)("stake_cpu_quantity", stake)
+                                                                       ("transfer", 1) ) );
+      if( liquid.get_amount() > 0 )
+         batch.emplace_back( token_transfer( creator, a, liquid ) );
+   }
+
+   // Pushes the batch as one transaction signed by eosio and starts a new block so block limits are never hit
+   void push_batch( std::vector<action>& batch ) {
+      if( batch.empty() )
+         return;
+      signed_transaction trx;
+      trx.actions = std::move( batch );
+      batch.clear();
+      set_transaction_headers( trx );
+      trx.sign( get_private_key( config::system_account_name, "active" ), control->get_chain_id() );
+      push_transaction( trx );
+      produce_block();
+   }
+
+   // Calls `append(batch, i)` for every i in [0, count), flushing every `batch_size` entries
+   template<typename F>
+   void in_batches( uint32_t count, F&& append ) {
+      std::vector<action> batch;
+      for( uint32_t i = 0; i < count; ++i ) {
+         append( batch, i );
+         if( (i + 1) % batch_size == 0 )
+            push_batch( batch );
+      }
+      push_batch( batch );
+   }
+
+   void populate() {
+      const auto stake  = core_sym::from_string("10.0000");
+      const auto liquid = core_sym::from_string("1000.0000");
+
+      configure_powerup();
+
+      in_batches( shape.producers, [&]( auto& batch, uint32_t i ) {
+         const name p = producer( i );
+         append_account( batch, p, stake, asset() );
+         batch.emplace_back( system_action( "regproducer"_n, p, mvo()("producer", p)("producer_key", get_public_key( p, "active" ))
+                                                                     ("url", "")("location", i) ) );
+      });
+
+      // enough stake to activate the chain, voting for the producers most voters pick as well;
+      // also provides most of the REX liquidity so that loans stay favorable at any scale
+      {
+         const auto rex = core_sym::from_string("10000000.0000");
+         std::vector<action> batch;
+         append_account( batch, whale, core_sym::from_string("75000000.0000"), rex );
+         batch.emplace_back( system_action( "voteproducer"_n, whale, mvo()("voter", whale)("proxy", name())("producers", producer_window( 0 )) ) );
+         batch.emplace_back( system_action( "deposit"_n, whale, mvo()("owner", whale)("amount", rex) ) );
+         batch.emplace_back( system_action( "buyrex"_n, whale, mvo()("from", whale)("amount", rex) ) );
+         push_batch( batch );
+      }
+
+      in_batches( shape.proxies, [&]( auto& batch, uint32_t i ) {
+         const name x = proxy( i );
+         append_account( batch, x, core_sym::from_string("10000.0000"), asset() );
+         batch.emplace_back( system_action( "regproxy"_n, x, mvo()("proxy", x)("isproxy", true) ) );
+         batch.emplace_back( system_action( "voteproducer"_n, x, mvo()("voter", x)("proxy", name())
+                                                                      ("producers", producer_window( (i * 7) % shape.producers )) ) );
+      });
+
+      // most of the vote weight goes to the first 60 or so producers, the long tail is only reached through proxies
+      in_batches( shape.voters, [&]( auto& batch, uint32_t i ) {
+         const name v = voter( i );
+         append_account( batch, v, stake, liquid );
+         if( is_proxied( i ) )
+            batch.emplace_back( system_action( "voteproducer"_n, v, mvo()("voter", v)("proxy", proxy( i % shape.proxies ))("producers", vector<name>()) ) );
+         else
+            batch.emplace_back( system_action( "voteproducer"_n, v, mvo()("voter", v)("proxy", name())("producers", producer_window( i % 31 )) ) );
+      });
+
+      in_batches( shape.rex_holders, [&]( auto& batch, uint32_t i ) {
+         const name v = voter( i );
+         batch.emplace_back( system_action( "deposit"_n, v, mvo()("owner", v)("amount", core_sym::from_string("100.0000")) ) );
+         batch.emplace_back( system_action( "buyrex"_n, v, mvo()("from", v)("amount", core_sym::from_string("100.0000")) ) );
+      });
+
+      in_batches( shape.loans, [&]( auto& batch, uint32_t i ) {
+         const name v = voter( i );
+         batch.emplace_back( system_action( "deposit"_n, v, mvo()("owner", v)("amount", core_sym::from_string("1.0000")) ) );
+         batch.emplace_back( system_action( i % 2 ? "rentnet"_n : "rentcpu"_n, v,
+                                            mvo()("from", v)("receiver", v)("loan_payment", core_sym::from_string("1.0000"))
+                                                 ("loan_fund", core_sym::from_string("0.0000")) ) );
+      });
+
+      in_batches( shape.powerup_orders, [&]( auto& batch, uint32_t i ) {
+         const name v = voter( i );
+         batch.emplace_back( system_action( "powerup"_n, v, mvo()("payer", v)("receiver", v)("days", powerup_days)
+                                                               ("net_frac", 10'000'000'000ll)("cpu_frac", 10'000'000'000ll)
+                                                               ("max_payment", core_sym::from_string("100.0000")) ) );
+      });
+
+      in_batches( shape.name_bids, [&]( auto& batch, uint32_t i ) {
+         const name v = voter( i );
+         batch.emplace_back( system_action( "bidname"_n, v, mvo()("bidder", v)("newname", bid_name( i ))
+                                                               ("bid", core_sym::from_string("1.0000")) ) );
+      });
+
+      // let the first producer schedule update happen outside of the measurements
+      produce_block( fc::minutes(2) );
+      produce_blocks( 2 * 21 );
+   }
+
+   void configure_powerup() {
+      create_accounts_with_resources( { reserve } );
+      auto resource = [&]() {
+         return mvo()("current_weight_ratio", 1'000'000'000'000'000ll)
+                     ("target_weight_ratio", 10'000'000'000'000ll)
+                     ("assumed_stake_weight", 100'000'000'0000ll)
+                     ("target_timestamp", time_point_sec( control->pending_block_time() + fc::days(100) ))
+                     ("exponent", 2)
+                     ("decay_secs", fc::days(1).to_seconds())
+                     ("min_price", core_sym::from_string("1000.0000"))
+                     ("max_price", core_sym::from_string("1000000.0000"));
+      };
+      base_tester::push_action( config::system_account_name, "cfgpowerup"_n, config::system_account_name,
+                                mvo()("args", mvo()("net", resource())("cpu", resource())("powerup_days", powerup_days)
+                                                   ("min_powerup_fee", core_sym::from_string("0.0001"))) );
+      produce_block();
+   }
+};
+
+} // namespace eosio_system
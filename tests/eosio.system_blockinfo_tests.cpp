@@ -1,4 +1,4 @@
-#include <functional>
+#include <algorithm>
 #include <limits>
 
 #include <boost/test/unit_test.hpp>
@@ -19,24 +19,48 @@
 
 namespace {
 
+// Height and timestamp of one recorded block, in order of ascending block height when returned by get_blockinfo_table
 struct block_info_record
 {
-   uint8_t        version = 0;
    uint32_t       block_height;
    fc::time_point block_timestamp;
 
    friend bool operator==(const block_info_record& lhs, const block_info_record& rhs)
    {
-      return std::tie(lhs.version, lhs.block_height, lhs.block_timestamp) ==
-             std::tie(rhs.version, rhs.block_height, rhs.block_timestamp);
+      return std::tie(lhs.block_height, lhs.block_timestamp) == std::tie(rhs.block_height, rhs.block_timestamp);
    }
 };
 
+struct block_info_slot
+{
+   uint8_t                            version      = 0;
+   uint32_t                           slot         = 0;
+   uint32_t                           block_height = 0;
+   eosio::chain::block_timestamp_type block_timestamp;
+};
+
+struct block_info_ring
+{
+   uint8_t  version             = 0;
+   uint32_t window_size         = 0;
+   uint32_t latest_block_height = 0;
+};
+
+// Row of the blockinfo table before it was turned into a ring, keyed by block height
+struct legacy_block_info_record
+{
+   uint8_t        version = 0;
+   uint32_t       block_height;
+   fc::time_point block_timestamp;
+};
+
 static constexpr uint32_t rolling_window_size = 10;
 
 } // namespace
 
-FC_REFLECT(block_info_record, (version)(block_height)(block_timestamp))
+FC_REFLECT(block_info_slot, (version)(slot)(block_height)(block_timestamp))
+FC_REFLECT(block_info_ring, (version)(window_size)(latest_block_height))
+FC_REFLECT(legacy_block_info_record, (version)(block_height)(block_timestamp))
 
 namespace {
 
@@ -45,82 +69,123 @@ using namespace system_contracts::testing;
 
 namespace blockinfo_tester = test_contracts::blockinfo_tester;
 
-static const eosio::chain::name blockinfo_table_name = "blockinfo"_n;
+static const eosio::chain::name blockinfo_table_name      = "blockinfo"_n;
+static const eosio::chain::name blockinfo_ring_table_name = "blockinforng"_n;
 
 // cspell:disable-next-line
 static const eosio::chain::name blockinfo_tester_account_name = "binfotester"_n;
 
 struct block_info_tester : eosio_system::eosio_system_tester
 {
-private:
-   std::optional<eosio::chain::table_id_object::id_type> get_blockinfo_table_id() const
-   {
-      const auto* table_id_itr = control->db().find<eosio::chain::table_id_object, eosio::chain::by_code_scope_table>(
-         boost::make_tuple(eosio::chain::config::system_account_name, eosio::chain::name{0}, blockinfo_table_name));
+   block_info_tester() : eosio_system_tester(eosio_system_tester::setup_level::deploy_contract) {}
 
-      if (!table_id_itr) {
-         // No blockinfo table exists.
+   /**
+    * Returns the position of the blockinfo ring, if the ring has been created.
+    */
+   std::optional<block_info_ring> get_blockinfo_ring()
+   {
+      std::vector<char> data = get_row_by_account(config::system_account_name, eosio::chain::name{0},
+                                                  blockinfo_ring_table_name, blockinfo_ring_table_name);
+      if (data.empty()) {
          return {};
       }
-
-      return std::optional<eosio::chain::table_id_object::id_type>(table_id_itr->id);
+      return fc::raw::unpack<block_info_ring>(data);
    }
 
-public:
-   block_info_tester() : eosio_system_tester(eosio_system_tester::setup_level::deploy_contract) {}
-
    /**
-    * Scans filtered rows in blockinfo table in order of ascending block height where filtering only picks rows
-    * corresponding to block heights in the closed interval [start_block_height, end_block_height].
-    *
-    * For each row visited, its deserialized block_info_record structure is passed into the visitor function.
-    * If a call to the visitor function returns false, scanning will stop and this function will return.
-    *
-    * @pre start_block_height <= end_block_height
-    * @returns number of rows visited
+    * Returns the blocks recorded in the rolling window of the blockinfo ring in order of ascending block height.
     */
-   unsigned int scan_blockinfo_table(uint32_t                               start_block_height,
-                                     uint32_t                               end_block_height,
-                                     std::function<bool(block_info_record)> visitor) const
+   std::vector<block_info_record> get_blockinfo_table()
    {
-      FC_ASSERT(start_block_height <= end_block_height, "invalid inputs");
+      std::vector<block_info_record> result;
 
-      auto t_id = get_blockinfo_table_id();
-      if (!t_id) {
-         // No blockinfo table exists, so there is nothing to scan through.
-         return 0;
+      auto ring = get_blockinfo_ring();
+      if (!ring || ring->window_size == 0) {
+         return result;
       }
 
-      const auto& idx = control->db().get_index<eosio::chain::key_value_index, eosio::chain::by_scope_primary>();
-
-      unsigned int rows_visited = 0;
-
-      block_info_record r;
-
-      for (auto itr = idx.lower_bound(boost::make_tuple(*t_id, static_cast<uint64_t>(start_block_height)));
-           itr != idx.end() && itr->t_id == *t_id && itr->primary_key <= end_block_height; ++itr) //
-      {
-         fc::datastream<const char*> ds(itr->value.data(), itr->value.size());
-         fc::raw::unpack(ds, r);
-         ++rows_visited;
-         if (!visitor(std::move(r))) {
-            break;
+      const uint32_t size  = ring->window_size;
+      const uint32_t first = ring->latest_block_height >= size ? ring->latest_block_height - size + 1 : 1;
+      for (uint32_t height = first; height <= ring->latest_block_height; ++height) {
+         std::vector<char> data = get_row_by_account(config::system_account_name, eosio::chain::name{0},
+                                                     blockinfo_table_name, eosio::chain::name{height % size});
+         if (data.empty()) {
+            continue;
+         }
+         const auto e = fc::raw::unpack<block_info_slot>(data);
+         if (e.block_height == height) {
+            result.push_back(block_info_record{
+               .block_height    = e.block_height,
+               .block_timestamp = e.block_timestamp.to_time_point(),
+            });
          }
       }
 
-      return rows_visited;
+      return result;
    }
 
-   std::vector<block_info_record> get_blockinfo_table()
+   /**
+    * Returns the number of rows of the blockinfo table.
+    */
+   uint32_t count_blockinfo_rows()
    {
-      std::vector<block_info_record> result;
+      const auto* t_id = control->db().find<eosio::chain::table_id_object, eosio::chain::by_code_scope_table>(
+         boost::make_tuple(config::system_account_name, eosio::chain::name{0}, blockinfo_table_name));
+      return t_id ? t_id->count : 0;
+   }
 
-      scan_blockinfo_table(0, std::numeric_limits<uint32_t>::max(), [&result](const block_info_record& r) {
-         result.push_back(r);
-         return true;
-      });
+   /**
+    * Replaces the blockinfo ring with one row per block for the `num_blocks` blocks up to the head block, as left by
+    * system contracts predating the ring. The rows are written directly to the state of both nodes, with no block
+    * pending, so that the next block applies the same migration on each.
+    */
+   void replace_blockinfo_with_legacy_rows(uint32_t num_blocks)
+   {
+      control->abort_block();
 
-      return result;
+      for (auto* node : {control.get(), validating_node.get()}) {
+         auto& db = node->mutable_db();
+
+         auto remove_table = [&](eosio::chain::name table) {
+            const auto* t_id = db.find<eosio::chain::table_id_object, eosio::chain::by_code_scope_table>(
+               boost::make_tuple(config::system_account_name, eosio::chain::name{0}, table));
+            if (!t_id) {
+               return;
+            }
+            const auto& idx = db.get_index<eosio::chain::key_value_index, eosio::chain::by_scope_primary>();
+            for (auto itr = idx.lower_bound(boost::make_tuple(t_id->id, 0));
+                 itr != idx.end() && itr->t_id == t_id->id;) {
+               db.remove(*itr++);
+            }
+            db.remove(*t_id);
+         };
+         remove_table(blockinfo_table_name);
+         remove_table(blockinfo_ring_table_name);
+
+         const auto& t_id = db.create<eosio::chain::table_id_object>([&](eosio::chain::table_id_object& t) {
+            t.code  = config::system_account_name;
+            t.scope = eosio::chain::name{0};
+            t.table = blockinfo_table_name;
+            t.payer = config::system_account_name;
+            t.count = num_blocks;
+         });
+
+         const uint32_t head_height    = node->head().block_num();
+         const auto     head_timestamp = node->head().block_time();
+         for (uint32_t height = head_height - num_blocks + 1; height <= head_height; ++height) {
+            const auto data = fc::raw::pack(legacy_block_info_record{
+               .block_height    = height,
+               .block_timestamp =
+                  head_timestamp - fc::milliseconds(eosio::chain::config::block_interval_ms * (head_height - height)),
+            });
+            db.create<eosio::chain::key_value_object>([&](eosio::chain::key_value_object& o) {
+               o.t_id        = t_id.id;
+               o.primary_key = height;
+               o.payer       = config::system_account_name;
+               o.value.assign(data.data(), data.size());
+            });
+         }
+      }
    }
 
    std::pair<std::optional<blockinfo_tester::latest_block_batch_info_result>, eosio::chain::transaction_trace_ptr>
@@ -310,6 +375,101 @@ try {
    actual_table = get_blockinfo_table();
    BOOST_CHECK(rolling_window_size == actual_table.size());
    BOOST_CHECK(check_tables_match(expected_table, actual_table));
+
+   // The slot of the erased start block has been reused in place.
+
+   auto ring = get_blockinfo_ring();
+   BOOST_REQUIRE(ring.has_value());
+   BOOST_CHECK_EQUAL(1u, ring->version);
+   BOOST_CHECK_EQUAL(rolling_window_size, ring->window_size);
+   BOOST_CHECK_EQUAL(cur_block_height - 1, ring->latest_block_height);
+   BOOST_CHECK_EQUAL(rolling_window_size, count_blockinfo_rows());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(setblockinfo_tests, block_info_tester)
+try {
+   BOOST_REQUIRE_EQUAL(error("missing authority of eosio"),
+                       push_action("eosio.token"_n, "setblockinfo"_n, mvo()("rolling_window_size", 5)));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("rolling_window_size must be between 1 and 1200"),
+                       push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 0)));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("rolling_window_size must be between 1 and 1200"),
+                       push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 1201)));
+
+   // Every block of the window is recorded and the latest recorded block is the last of the table.
+   auto check_window = [this](uint32_t window_size) {
+      auto table = get_blockinfo_table();
+      auto ring  = get_blockinfo_ring();
+      BOOST_REQUIRE(ring.has_value());
+      BOOST_REQUIRE_EQUAL(window_size, ring->window_size);
+      BOOST_REQUIRE_EQUAL(window_size, table.size());
+      BOOST_REQUIRE_EQUAL(window_size, count_blockinfo_rows());
+      BOOST_CHECK_EQUAL(ring->latest_block_height, table.back().block_height);
+      for (size_t i = 1; i < table.size(); ++i) {
+         BOOST_CHECK_EQUAL(table[i - 1].block_height + 1, table[i].block_height);
+      }
+      return table;
+   };
+
+   produce_blocks(rolling_window_size);
+   auto full_table = check_window(rolling_window_size);
+
+   // Shrinking the window keeps the latest blocks.
+
+   BOOST_REQUIRE_EQUAL(success(),
+                       push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 4)));
+   auto shrunk_table = check_window(4);
+   BOOST_CHECK(shrunk_table.front().block_height > full_table.front().block_height);
+   BOOST_CHECK(shrunk_table.front() == *std::find_if(full_table.begin(), full_table.end(), [&](const auto& r) {
+      return r.block_height == shrunk_table.front().block_height;
+   }));
+
+   produce_blocks(1);
+   check_window(4);
+
+   // Growing the window keeps every recorded block and fills the new slots as blocks are produced.
+
+   BOOST_REQUIRE_EQUAL(success(),
+                       push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 20)));
+   BOOST_CHECK(get_blockinfo_table().size() >= 4);
+
+   produce_blocks(30);
+   check_window(20);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(blockinfo_migration_tests, block_info_tester)
+try {
+   produce_blocks(rolling_window_size);
+
+   replace_blockinfo_with_legacy_rows(rolling_window_size);
+   BOOST_REQUIRE(!get_blockinfo_ring().has_value());
+   BOOST_REQUIRE_EQUAL(rolling_window_size, count_blockinfo_rows());
+
+   // The first onblock erases the rows of the old layout and creates the ring with the block it records.
+
+   produce_blocks(1);
+
+   auto ring = get_blockinfo_ring();
+   BOOST_REQUIRE(ring.has_value());
+   BOOST_CHECK_EQUAL(1u, ring->version);
+   BOOST_CHECK_EQUAL(rolling_window_size, ring->window_size);
+   BOOST_CHECK_EQUAL(1u, count_blockinfo_rows());
+
+   auto table = get_blockinfo_table();
+   BOOST_REQUIRE_EQUAL(1u, table.size());
+   BOOST_CHECK_EQUAL(ring->latest_block_height, table.back().block_height);
+
+   // The ring then fills up to the window as before.
+
+   produce_blocks(rolling_window_size);
+   BOOST_CHECK_EQUAL(rolling_window_size, get_blockinfo_table().size());
+   BOOST_CHECK_EQUAL(rolling_window_size, count_blockinfo_rows());
+
+   BOOST_REQUIRE_EQUAL(success(),
+                       push_action(config::system_account_name, "setblockinfo"_n, mvo()("rolling_window_size", 4)));
+   BOOST_CHECK_EQUAL(4u, get_blockinfo_table().size());
+   BOOST_CHECK_EQUAL(4u, count_blockinfo_rows());
 }
 FC_LOG_AND_RETHROW()
 
@@ -832,6 +832,12 @@ public:
             account_name owner; fc::raw::unpack( ds, owner );
             asset proceeds; fc::raw::unpack( ds, proceeds );
             output.emplace_back( owner, proceeds );
+         } else if ( trace->action_traces[i].act.name == "orderresults"_n ) {
+            std::vector<std::pair<account_name, asset>> results;
+            fc::raw::unpack( trace->action_traces[i].act.data.data(),
+                             trace->action_traces[i].act.data.size(),
+                             results );
+            output.insert( output.end(), results.begin(), results.end() );
          }
       }
       return output;
@@ -880,6 +886,17 @@ public:
       return rented_tokens;
    }
 
+   fc::variant rexquote( const account_name& owner, const asset& payment, const asset& rex, const asset& loan_payment ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( get_action( config::system_account_name, "rexquote"_n, vector<permission_level>{},
+                                            mvo()("owner", owner)("payment", payment)("rex", rex)("loan_payment", loan_payment) ) );
+      set_transaction_headers( trx );
+      auto trace = push_transaction( trx, fc::time_point::maximum(), DEFAULT_BILLED_CPU_TIME_US, false,
+                                     transaction_metadata::trx_type::read_only );
+      return abi_ser.binary_to_variant( "rex_quote", trace->action_traces[0].return_value,
+                                        abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
    asset get_rentcpu_result( const account_name& from, const account_name& receiver, const asset& payment ) {
       return _get_rentrex_result( from, receiver, payment, true );
    }
@@ -1216,14 +1233,31 @@ public:
       return get_voter_info( account_name(act) );
    }
 
+   fc::variant get_vote_set( uint64_t id ) {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "votesets"_n, name(id) );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "vote_set", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
+   // `unpaid_blocks` includes the blocks counted in the `prodblocks` table
    fc::variant get_producer_info( const account_name& act ) {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "producers"_n, act );
-      return abi_ser.binary_to_variant( "producer_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      fc::variant info = abi_ser.binary_to_variant( "producer_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      const uint32_t blocks = get_producer_blocks( act );
+      if( blocks == 0 ) return info;
+      fc::mutable_variant_object result( info.get_object() );
+      result( "unpaid_blocks", info["unpaid_blocks"].as<uint32_t>() + blocks );
+      return result;
    }
    fc::variant get_producer_info( std::string_view act ) {
       return get_producer_info( account_name(act) );
    }
 
+   uint32_t get_producer_blocks( const account_name& act ) {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "prodblocks"_n, act );
+      if( data.empty() ) return 0;
+      return abi_ser.binary_to_variant( "producer_blocks", data, abi_serializer::create_yield_function(abi_serializer_max_time) )["unpaid_blocks"].as<uint32_t>();
+   }
+
    fc::variant get_producer_info2( const account_name& act ) {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "producers2"_n, act );
       return abi_ser.binary_to_variant( "producer_info2", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
@@ -1374,6 +1408,11 @@ public:
       return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "eosio_global_state4", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
    }
 
+   fc::variant get_global_states() {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "globalstate"_n, "globalstate"_n );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "eosio_global_states", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
    fc::variant get_refund_request( name account ) {
       vector<char> data = get_row_by_account( config::system_account_name, account, "refunds"_n, account );
       return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "refund_request", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
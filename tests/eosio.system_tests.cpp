@@ -1151,6 +1151,141 @@ BOOST_FIXTURE_TEST_CASE( more_than_30_producer_voting, eosio_system_tester ) try
 } FC_LOG_AND_RETHROW()
 
 
+BOOST_FIXTURE_TEST_CASE( vote_weight_follows_weekly_factor, eosio_system_tester ) try {
+   issue_and_transfer( "bob111111111", core_sym::from_string("2000.0000"),  config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("13.0000"), core_sym::from_string("0.5791") ) );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( "alice1111111"_n ) );
+
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { "alice1111111"_n } ) );
+   const double first_weight = get_voter_info( "bob111111111" )["last_vote_weight"].as_double();
+   BOOST_REQUIRE_EQUAL( stake2votes( core_sym::from_string("13.5791") ), first_weight );
+
+   // the weight is computed with the factor of the current week, bit for bit, for every week of more than a year
+   double previous_weight = first_weight;
+   for( int week = 0; week < 60; ++week ) {
+      produce_block( fc::days(7) );
+      BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { "alice1111111"_n } ) );
+      const double weight = get_voter_info( "bob111111111" )["last_vote_weight"].as_double();
+      BOOST_REQUIRE_EQUAL( stake2votes( core_sym::from_string("13.5791") ), weight );
+      BOOST_REQUIRE( previous_weight < weight );
+      BOOST_REQUIRE_EQUAL( weight, get_producer_info( "alice1111111" )["total_votes"].as_double() );
+      previous_weight = weight;
+   }
+
+} FC_LOG_AND_RETHROW()
+
+
+BOOST_FIXTURE_TEST_CASE( interned_vote_sets, eosio_system_tester, * boost::unit_test::tolerance(1e-8) ) try {
+   const name p1 = "defproducer1"_n, p2 = "defproducer2"_n, p3 = "defproducer3"_n;
+   create_accounts_with_resources( { p1, p2, p3 } );
+   for( const auto& p : { p1, p2, p3 } ) {
+      BOOST_REQUIRE_EQUAL( success(), regproducer( p ) );
+   }
+   for( const auto& v : { "alice1111111"_n, "bob111111111"_n, "carol1111111"_n } ) {
+      issue_and_transfer( v, core_sym::from_string("1000.0000"),  config::system_account_name );
+      BOOST_REQUIRE_EQUAL( success(), stake( v, core_sym::from_string("50.0000"), core_sym::from_string("50.0000") ) );
+   }
+   const uint32_t interned = 16;
+   auto is_interned = [&]( const name& v ) { return ( get_voter_info( v )["flags1"].as_uint64() & interned ) != 0; };
+   auto vote_set_id = [&]( const name& v ) { return get_voter_info( v )["reserved2"].as_uint64(); };
+
+   // votes cast before vote sets are enabled keep their producers in the voter row
+   BOOST_REQUIRE_EQUAL( success(), vote( "alice1111111"_n, { p1, p2 } ) );
+
+   BOOST_REQUIRE_EQUAL( error("missing authority of eosio"),
+                        push_action( "alice1111111"_n, "cfgvotesets"_n, mvo()("enabled", true) ) );
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "cfgvotesets"_n, mvo()("enabled", true) ) );
+
+   // identical votes share a single vote set, billed to the system contract rather than the voter creating it
+   const auto& rlm = control->get_resource_limits_manager();
+   const int64_t bob_ram = rlm.get_account_ram_usage( "bob111111111"_n );
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { p1, p2 } ) );
+   BOOST_REQUIRE_EQUAL( bob_ram, rlm.get_account_ram_usage( "bob111111111"_n ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "carol1111111"_n, { p1, p2 } ) );
+   BOOST_REQUIRE( !is_interned( "alice1111111"_n ) );
+   BOOST_REQUIRE( is_interned( "bob111111111"_n ) );
+   BOOST_REQUIRE( is_interned( "carol1111111"_n ) );
+   BOOST_REQUIRE( get_voter_info( "bob111111111" )["producers"].get_array().empty() );
+   const auto shared_id = vote_set_id( "bob111111111"_n );
+   BOOST_REQUIRE_EQUAL( shared_id, vote_set_id( "carol1111111"_n ) );
+   BOOST_REQUIRE_EQUAL( 2, get_vote_set( shared_id )["refcount"].as_uint64() );
+   BOOST_REQUIRE( ( vector<account_name>{ p1, p2 } ) == get_vote_set( shared_id )["producers"].as<vector<account_name>>() );
+   BOOST_TEST_REQUIRE( 3 * stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p2 )["total_votes"].as_double() );
+
+   // stake changes reach the producers of an interned vote
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("25.0000"), core_sym::from_string("25.0000") ) );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("350.0000") ) == get_producer_info( p1 )["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( shared_id, vote_set_id( "bob111111111"_n ) );
+
+   // a different vote references another set, unused sets are removed
+   BOOST_REQUIRE_EQUAL( success(), vote( "carol1111111"_n, { p3 } ) );
+   BOOST_REQUIRE_EQUAL( 1, get_vote_set( shared_id )["refcount"].as_uint64() );
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { } ) );
+   BOOST_REQUIRE( !is_interned( "bob111111111"_n ) );
+   BOOST_REQUIRE( get_vote_set( shared_id ).is_null() );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p1 )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p3 )["total_votes"].as_double() );
+
+   // once disabled, the next vote stores the producers in the voter row again
+   const auto carol_id = vote_set_id( "carol1111111"_n );
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "cfgvotesets"_n, mvo()("enabled", false) ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "carol1111111"_n, { p3 } ) );
+   BOOST_REQUIRE( !is_interned( "carol1111111"_n ) );
+   BOOST_REQUIRE( ( vector<account_name>{ p3 } ) == get_voter_info( "carol1111111" )["producers"].as<vector<account_name>>() );
+   BOOST_REQUIRE( get_vote_set( carol_id ).is_null() );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p3 )["total_votes"].as_double() );
+
+} FC_LOG_AND_RETHROW()
+
+
+BOOST_FIXTURE_TEST_CASE( deferred_vote_tally, eosio_system_tester, * boost::unit_test::tolerance(1e-8) ) try {
+   cross_15_percent_threshold();
+
+   const name p1 = "defproducer1"_n, p2 = "defproducer2"_n;
+   create_accounts_with_resources( { p1, p2 } );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( p1 ) );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( p2 ) );
+   issue_and_transfer( "bob111111111", core_sym::from_string("1000.0000"),  config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("50.0000"), core_sym::from_string("50.0000") ) );
+
+   auto get_vote_tally = [&]() {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "votetally"_n, name(0) );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "vote_tally", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   };
+
+   BOOST_REQUIRE_EQUAL( error("missing authority of eosio"),
+                        push_action( "alice1111111"_n, "cfgvotetally"_n, mvo()("deferred", true) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("deferred vote tallying is not enabled"),
+                        push_action( config::system_account_name, "cfgvotetally"_n, mvo()("deferred", false) ) );
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "cfgvotetally"_n, mvo()("deferred", true) ) );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("deferred vote tallying is already enabled"),
+                        push_action( config::system_account_name, "cfgvotetally"_n, mvo()("deferred", true) ) );
+
+   // votes are only recorded in the tally, registration is still checked right away
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("producer alice1111111 is not registered"),
+                        vote( "bob111111111"_n, { "alice1111111"_n } ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { p1, p2 } ) );
+   BOOST_REQUIRE_EQUAL( 0, get_producer_info( p1 )["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( 2, get_vote_tally()["deltas"].get_array().size() );
+
+   // and applied before the next producer schedule update
+   produce_block( fc::minutes(2) );
+   produce_block();
+   BOOST_REQUIRE_EQUAL( 0, get_vote_tally()["deltas"].get_array().size() );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p1 )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p2 )["total_votes"].as_double() );
+
+   // disabling applies the pending changes
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { p2 } ) );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p1 )["total_votes"].as_double() );
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "cfgvotetally"_n, mvo()("deferred", false) ) );
+   BOOST_REQUIRE( get_vote_tally().is_null() );
+   BOOST_REQUIRE_EQUAL( 0, get_producer_info( p1 )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes( core_sym::from_string("100.0000") ) == get_producer_info( p2 )["total_votes"].as_double() );
+
+} FC_LOG_AND_RETHROW()
+
+
 BOOST_FIXTURE_TEST_CASE( vote_same_producer_30_times, eosio_system_tester ) try {
    issue_and_transfer( "bob111111111", core_sym::from_string("2000.0000"),  config::system_account_name );
    BOOST_REQUIRE_EQUAL( success(), stake( "bob111111111", core_sym::from_string("50.0000"), core_sym::from_string("50.0000") ) );
@@ -1453,6 +1588,12 @@ BOOST_FIXTURE_TEST_CASE( proxy_actions_affect_producers, eosio_system_tester, *
    BOOST_REQUIRE_EQUAL( 0, get_producer_info( "defproducer2" )["total_votes"].as_double() );
    BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("180.0003")) == get_producer_info( "defproducer3" )["total_votes"].as_double() );
 
+   //re-voting through the same proxy leaves the proxy and its producers unchanged
+   BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, vector<account_name>(), "alice1111111"_n ) );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("150.0003")) == get_voter_info( "alice1111111" )["proxied_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("180.0003")) == get_producer_info( "defproducer1" )["total_votes"].as_double() );
+   BOOST_TEST_REQUIRE( stake2votes(core_sym::from_string("180.0003")) == get_producer_info( "defproducer3" )["total_votes"].as_double() );
+
 } FC_LOG_AND_RETHROW()
 
 BOOST_FIXTURE_TEST_CASE(producer_pay, eosio_system_tester, * boost::unit_test::tolerance(1e-10)) try {
@@ -1496,6 +1637,8 @@ BOOST_FIXTURE_TEST_CASE(producer_pay, eosio_system_tester, * boost::unit_test::t
       BOOST_REQUIRE(1 < unpaid_blocks);
 
       BOOST_REQUIRE_EQUAL(initial_tot_unpaid_blocks, unpaid_blocks);
+      // onblock counts the blocks in the `prodblocks` table and leaves the `producers` row untouched
+      BOOST_REQUIRE_EQUAL(unpaid_blocks, get_producer_blocks("defproducera"_n));
 
       const asset initial_supply  = get_token_supply();
       const asset initial_balance = get_balance("defproducera"_n);
@@ -3275,6 +3418,18 @@ BOOST_FIXTURE_TEST_CASE( elect_producers /*_and_parameters*/, eosio_system_teste
    //config = config_to_variant( control->get_global_properties().configuration );
    //REQUIRE_EQUAL_OBJECTS(prod2_config, config);
 
+   // the digest of the last proposed schedule is kept so that an unchanged schedule is not proposed again
+   {
+      const auto data = get_row_by_account( config::system_account_name, config::system_account_name, "lastpropsch"_n, name(0) );
+      BOOST_REQUIRE( !data.empty() );
+      const auto last_prop = abi_ser.binary_to_variant( "last_prop_producers_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      BOOST_REQUIRE_EQUAL( fc::sha256::hash( fc::raw::pack( producer_schedule.producers ) ).str(), last_prop["schedule_hash"].as_string() );
+
+      const auto version = producer_schedule.version;
+      produce_blocks(250);
+      BOOST_REQUIRE_EQUAL( version, control->active_producers().version );
+   }
+
    // try to go back to 2 producers and fail
    BOOST_REQUIRE_EQUAL( success(), vote( "bob111111111"_n, { "defproducer3"_n } ) );
    produce_blocks(250);
@@ -3294,6 +3449,50 @@ BOOST_FIXTURE_TEST_CASE( elect_producers /*_and_parameters*/, eosio_system_teste
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( rejected_schedule_is_proposed_again, eosio_system_tester ) try {
+   const std::vector<account_name> producers = { "defproducer1"_n, "defproducer2"_n, "defproducer3"_n };
+   create_accounts_with_resources( producers );
+   for( const auto& p : producers ) {
+      BOOST_REQUIRE_EQUAL( success(), regproducer( p ) );
+   }
+   transfer( "eosio", "alice1111111", core_sym::from_string("600000000.0000"), "eosio" );
+   BOOST_REQUIRE_EQUAL( success(), stake( "alice1111111", "alice1111111", core_sym::from_string("300000000.0000"), core_sym::from_string("300000000.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "alice1111111"_n, producers ) );
+   produce_blocks(250);
+   BOOST_REQUIRE_EQUAL( 3, control->active_producers().producers.size() );
+
+   auto rotate_key = [&]( const account_name& producer ) {
+      block_signing_private_keys.emplace( get_public_key( producer, "bs1" ), get_private_key( producer, "bs1" ) );
+      BOOST_REQUIRE_EQUAL( success(), push_action( producer, "regproducer"_n, mvo()
+                                                   ("producer",  producer)
+                                                   ("producer_key", get_public_key( producer, "bs1" ) )
+                                                   ("url", "")
+                                                   ("location", 0)
+                           )
+      );
+      produce_block();
+   };
+   auto active_key = [&]( const account_name& producer ) {
+      for( const auto& p : control->active_producers().producers ) {
+         if( p.producer_name == producer )
+            return std::get<block_signing_authority_v0>( p.authority ).keys[0].key;
+      }
+      return public_key_type();
+   };
+
+   // the second schedule update proposes a schedule while the first proposal is still waiting to become pending,
+   // which the host rejects
+   rotate_key( "defproducer1"_n );
+   produce_block( fc::minutes(2) );
+   rotate_key( "defproducer2"_n );
+   produce_block( fc::minutes(2) );
+
+   // the rejected schedule is proposed again by a later update
+   produce_blocks(500);
+   BOOST_REQUIRE_EQUAL( get_public_key( "defproducer1"_n, "bs1" ), active_key( "defproducer1"_n ) );
+   BOOST_REQUIRE_EQUAL( get_public_key( "defproducer2"_n, "bs1" ), active_key( "defproducer2"_n ) );
+} FC_LOG_AND_RETHROW()
+
 
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE(eosio_system_name_tests)
@@ -3821,6 +4020,52 @@ BOOST_FIXTURE_TEST_CASE( setram_effect, eosio_system_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( merge_global_state, eosio_system_tester ) try {
+   const name alice = "alice1111111"_n;
+   transfer( config::system_account_name, alice, core_sym::from_string("100.0000"), config::system_account_name );
+   BOOST_REQUIRE( get_global_states().is_null() );
+
+   BOOST_REQUIRE_EQUAL( error("missing authority of eosio"),
+                        push_action( alice, "mergeglobals"_n, mvo()("mirror_legacy", true) ) );
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "mergeglobals"_n, mvo()("mirror_legacy", true) ) );
+
+   auto merged = get_global_states();
+   BOOST_REQUIRE_EQUAL( true, merged["mirror_legacy"].as<bool>() );
+   BOOST_REQUIRE_EQUAL( get_global_state()["total_ram_bytes_reserved"].as<uint64_t>(),
+                        merged["global"]["total_ram_bytes_reserved"].as<uint64_t>() );
+   BOOST_REQUIRE_EQUAL( get_global_state4()["votepay_factor"].as<int64_t>(), merged["global4"]["votepay_factor"].as<int64_t>() );
+
+   // while mirroring, changes reach both the merged and the legacy rows
+   const uint64_t reserved = merged["global"]["total_ram_bytes_reserved"].as<uint64_t>();
+   BOOST_REQUIRE_EQUAL( success(), buyrambytes( alice, alice, 1000 ) );
+   merged = get_global_states();
+   const uint64_t reserved_after = merged["global"]["total_ram_bytes_reserved"].as<uint64_t>();
+   BOOST_REQUIRE( reserved < reserved_after );
+   BOOST_REQUIRE_EQUAL( reserved_after, get_global_state()["total_ram_bytes_reserved"].as<uint64_t>() );
+
+   // once mirroring stops the legacy rows are removed and only the merged row is kept up to date
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "mergeglobals"_n, mvo()("mirror_legacy", false) ) );
+   BOOST_REQUIRE( get_row_by_account( config::system_account_name, config::system_account_name, "global"_n, "global"_n ).empty() );
+   BOOST_REQUIRE( get_global_state2().is_null() );
+   BOOST_REQUIRE( get_global_state3().is_null() );
+   BOOST_REQUIRE( get_global_state4().is_null() );
+
+   BOOST_REQUIRE_EQUAL( success(), buyrambytes( alice, alice, 1000 ) );
+   merged = get_global_states();
+   BOOST_REQUIRE_EQUAL( false, merged["mirror_legacy"].as<bool>() );
+   BOOST_REQUIRE( reserved_after < merged["global"]["total_ram_bytes_reserved"].as<uint64_t>() );
+   BOOST_REQUIRE( get_row_by_account( config::system_account_name, config::system_account_name, "global"_n, "global"_n ).empty() );
+
+   // mirroring again writes all four legacy rows from the merged row, including those that do not change
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "mergeglobals"_n, mvo()("mirror_legacy", true) ) );
+   merged = get_global_states();
+   BOOST_REQUIRE_EQUAL( true, merged["mirror_legacy"].as<bool>() );
+   BOOST_REQUIRE_EQUAL( merged["global"]["total_ram_bytes_reserved"].as<uint64_t>(), get_global_state()["total_ram_bytes_reserved"].as<uint64_t>() );
+   BOOST_REQUIRE_EQUAL( merged["global2"]["new_ram_per_block"].as<uint16_t>(), get_global_state2()["new_ram_per_block"].as<uint16_t>() );
+   BOOST_REQUIRE_EQUAL( merged["global3"]["last_vpay_state_update"].as_string(), get_global_state3()["last_vpay_state_update"].as_string() );
+   BOOST_REQUIRE_EQUAL( merged["global4"]["votepay_factor"].as<int64_t>(), get_global_state4()["votepay_factor"].as<int64_t>() );
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE( ram_inflation, eosio_system_tester ) try {
 
    const uint64_t init_max_ram_size = 64ll*1024 * 1024 * 1024;
@@ -4055,6 +4300,59 @@ BOOST_FIXTURE_TEST_CASE( rex_rounding_issue, eosio_system_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( voteupdates_batch, eosio_system_tester, * boost::unit_test::tolerance(1e-8) ) try {
+   const std::vector<name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+   const name alice = accounts[0], bob = accounts[1], proxy = "proxyaccount"_n, producer = "defproducer1"_n;
+   setup_rex_accounts( accounts, core_sym::from_string("1000.0000") );
+   for( const auto& a : accounts ) {
+      BOOST_REQUIRE_EQUAL( success(), buyrex( a, core_sym::from_string("500.0000") ) );
+   }
+   create_accounts_with_resources( { producer } );
+   BOOST_REQUIRE_EQUAL( success(), regproducer( producer ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( proxy, { producer } ) );
+
+   // every voter has to authorize its update
+   BOOST_REQUIRE_EQUAL( error("missing authority of bobbyaccount"),
+                        push_action( alice, "voteupdates"_n, mvo()("voter_names", accounts) ) );
+
+   // a week later every vote is worth more
+   produce_block( fc::days(7) );
+   const double proxy_weight = get_voter_info( proxy )["last_vote_weight"].as_double();
+   {
+      signed_transaction trx;
+      set_transaction_headers(trx);
+      trx.actions.emplace_back( get_action( config::system_account_name, "voteupdates"_n,
+                                            { {alice, config::active_name}, {bob, config::active_name} },
+                                            mvo()("voter_names", accounts) ) );
+      trx.sign( get_private_key( alice, "active" ), control->get_chain_id() );
+      trx.sign( get_private_key( bob, "active" ), control->get_chain_id() );
+      push_transaction( trx );
+   }
+
+   double proxied_weight = 0;
+   for( const auto& a : accounts ) {
+      const auto info = get_voter_info( a );
+      const asset staked( info["staked"].as_int64(), symbol{CORE_SYM} );
+      BOOST_TEST_REQUIRE( stake2votes( staked ) == info["last_vote_weight"].as_double() );
+      proxied_weight += info["last_vote_weight"].as_double();
+   }
+   BOOST_TEST_REQUIRE( proxied_weight == get_voter_info( proxy )["proxied_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( proxy_weight < get_voter_info( proxy )["last_vote_weight"].as_double() );
+   BOOST_TEST_REQUIRE( get_voter_info( proxy )["last_vote_weight"].as_double() == get_producer_info( producer )["total_votes"].as_double() );
+
+   // the first update records the total stake delegated by each voter, which is maintained from then on
+   BOOST_REQUIRE_EQUAL( core_sym::from_string("20.0000"), get_voter_info( alice )["reserved3"].as<asset>() );
+   transfer( config::system_account_name, alice, core_sym::from_string("3.0000"), config::system_account_name );
+   BOOST_REQUIRE_EQUAL( success(), stake( alice, bob, core_sym::from_string("1.0000"), core_sym::from_string("2.0000") ) );
+   BOOST_REQUIRE_EQUAL( core_sym::from_string("23.0000"), get_voter_info( alice )["reserved3"].as<asset>() );
+   BOOST_REQUIRE_EQUAL( success(), unstake( alice, alice, core_sym::from_string("5.0000"), core_sym::from_string("5.0000") ) );
+   BOOST_REQUIRE_EQUAL( core_sym::from_string("13.0000"), get_voter_info( alice )["reserved3"].as<asset>() );
+   const int64_t staked = get_voter_info( alice )["staked"].as_int64();
+   BOOST_REQUIRE_EQUAL( success(), push_action( alice, "voteupdate"_n, mvo()("voter_name", alice) ) );
+   BOOST_REQUIRE_EQUAL( staked, get_voter_info( alice )["staked"].as_int64() );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE( rex_auth, eosio_system_tester ) try {
 
    const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
@@ -4156,6 +4454,71 @@ BOOST_FIXTURE_TEST_CASE( buy_sell_rex, eosio_system_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( rex_quote, eosio_system_tester ) try {
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n };
+   account_name alice = accounts[0], bob = accounts[1], carol = accounts[2];
+   setup_rex_accounts( accounts, core_sym::from_string("25000.0000") );
+   const asset zero_eos = core_sym::from_string("0.0000");
+   const asset zero_rex = asset::from_string("0.0000 REX");
+
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("20000.0000") ) );
+
+   auto quote = rexquote( bob, core_sym::from_string("100.0000"), zero_rex, zero_eos );
+   BOOST_REQUIRE_EQUAL( get_buyrex_result( bob, core_sym::from_string("100.0000") ), quote["rex_received"].as<asset>() );
+
+   // only matured REX can be sold
+   BOOST_REQUIRE_EQUAL( zero_rex, rexquote( alice, zero_eos, zero_rex, zero_eos )["sellable_rex"].as<asset>() );
+   produce_blocks(2);
+   produce_block( fc::days(5) );
+   quote = rexquote( alice, zero_eos, asset::from_string("1000.0000 REX"), zero_eos );
+   BOOST_REQUIRE_EQUAL( get_rex_balance( alice ), quote["sellable_rex"].as<asset>() );
+   BOOST_REQUIRE( quote["sell_fills"].as_bool() );
+   BOOST_REQUIRE_EQUAL( get_sellrex_result( alice, asset::from_string("1000.0000 REX") ), quote["proceeds"].as<asset>() );
+
+   quote = rexquote( name(), zero_eos, zero_rex, core_sym::from_string("10.0000") );
+   BOOST_REQUIRE_EQUAL( get_rentcpu_result( carol, carol, core_sym::from_string("10.0000") ), quote["rented_tokens"].as<asset>() );
+
+   // quotes include the loan fees update_rex_pool has not yet added to the pool
+   produce_block( fc::days(1) );
+   quote = rexquote( name(), core_sym::from_string("100.0000"), zero_rex, zero_eos );
+   BOOST_REQUIRE_EQUAL( get_buyrex_result( bob, core_sym::from_string("100.0000") ), quote["rex_received"].as<asset>() );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("rex must be (REX, 4)"),
+                        push_action( alice, "rexquote"_n, mvo()("owner", alice)("payment", zero_eos)("rex", zero_eos)("loan_payment", zero_eos) ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( rex_quote_read_only, eosio_system_tester ) try {
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+   account_name alice = accounts[0], bob = accounts[1];
+   setup_rex_accounts( accounts, core_sym::from_string("25000.0000") );
+
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("20000.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), rentcpu( bob, bob, core_sym::from_string("10.0000") ) );
+   produce_blocks(2);
+   produce_block( fc::days(5) );
+
+   // the loan fee is due to the pool, so the quote advances the return pool; a read-only transaction fails on any
+   // write, including one made by the system_contract destructor
+   const auto rex_pool    = get_rex_pool();
+   const auto return_pool = get_rex_return_pool();
+   signed_transaction trx;
+   trx.actions.emplace_back( get_action( config::system_account_name, "rexquote"_n, vector<permission_level>{},
+                                         mvo()("owner", alice)
+                                              ("payment", core_sym::from_string("100.0000"))
+                                              ("rex", asset::from_string("1000.0000 REX"))
+                                              ("loan_payment", core_sym::from_string("10.0000")) ) );
+   set_transaction_headers( trx );
+   auto trace = push_transaction( trx, fc::time_point::maximum(), DEFAULT_BILLED_CPU_TIME_US, false,
+                                  transaction_metadata::trx_type::read_only );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+   BOOST_REQUIRE( trace->action_traces[0].account_ram_deltas.empty() );
+   BOOST_REQUIRE( !trace->action_traces[0].return_value.empty() );
+
+   BOOST_REQUIRE_EQUAL( rex_pool["total_lendable"].as<asset>(), get_rex_pool()["total_lendable"].as<asset>() );
+   BOOST_REQUIRE_EQUAL( return_pool["last_dist_time"].as_string(), get_rex_return_pool()["last_dist_time"].as_string() );
+   BOOST_REQUIRE_EQUAL( return_pool["pending_bucket_proceeds"].as_int64(), get_rex_return_pool()["pending_bucket_proceeds"].as_int64() );
+} FC_LOG_AND_RETHROW()
+
 
 BOOST_FIXTURE_TEST_CASE( buy_sell_small_rex, eosio_system_tester ) try {
 
@@ -4608,6 +4971,54 @@ BOOST_FIXTURE_TEST_CASE( buy_sell_claim_rex, eosio_system_tester ) try {
 } FC_LOG_AND_RETHROW()
 
 
+BOOST_FIXTURE_TEST_CASE( aggregated_rex_order_results, eosio_system_tester ) try {
+
+   const asset init_balance = core_sym::from_string("3000000.0000");
+   const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n, "emilyaccount"_n };
+   account_name alice = accounts[0], bob = accounts[1], carol = accounts[2], emily = accounts[3];
+   setup_rex_accounts( accounts, init_balance );
+
+   BOOST_REQUIRE_EQUAL( error("missing authority of eosio"),
+                        push_action( alice, "cfgrexresult"_n, mvo()("aggregate", true) ) );
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, "cfgrexresult"_n, mvo()("aggregate", true) ) );
+
+   BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("50000.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( bob,   core_sym::from_string("105500.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), buyrex( carol, core_sym::from_string("104500.0000") ) );
+   for (uint8_t i = 0; i < 4; ++i) {
+      BOOST_REQUIRE_EQUAL( success(), rentcpu( emily, emily, core_sym::from_string("12000.0000") ) );
+   }
+
+   // most of the REX pool is lent out, so bob's and carol's orders are queued
+   produce_block( fc::days(6) );
+   BOOST_REQUIRE_EQUAL( success(), sellrex( bob,   get_rex_balance(bob) ) );
+   BOOST_REQUIRE_EQUAL( success(), sellrex( carol, get_rex_balance(carol) ) );
+   BOOST_REQUIRE_EQUAL( true,      get_rex_order(bob)["is_open"].as<bool>() );
+   BOOST_REQUIRE_EQUAL( true,      get_rex_order(carol)["is_open"].as<bool>() );
+
+   // once emily's loans have expired both orders are filled by the same batch and reported by one action
+   produce_block( fc::days(25) );
+   auto trace = base_tester::push_action( config::system_account_name, "rexexec"_n, alice,
+                                          mvo()("user", alice)("max", 4) );
+   auto count = [&]( const action_name& act ) {
+      return std::count_if( trace->action_traces.begin(), trace->action_traces.end(),
+                            [&]( const auto& t ) { return t.act.name == act; } );
+   };
+   BOOST_REQUIRE_EQUAL( 0, count( "orderresult"_n ) );
+   BOOST_REQUIRE_EQUAL( 1, count( "orderresults"_n ) );
+
+   auto output = get_rexorder_result( trace );
+   BOOST_REQUIRE_EQUAL( output.size(),    2 );
+   BOOST_REQUIRE_EQUAL( output[0].first,  bob );
+   BOOST_REQUIRE_EQUAL( output[0].second, get_rex_order(bob)["proceeds"].as<asset>() );
+   BOOST_REQUIRE_EQUAL( output[1].first,  carol );
+   BOOST_REQUIRE_EQUAL( output[1].second, get_rex_order(carol)["proceeds"].as<asset>() );
+   BOOST_REQUIRE_EQUAL( false,            get_rex_order(bob)["is_open"].as<bool>() );
+   BOOST_REQUIRE_EQUAL( false,            get_rex_order(carol)["is_open"].as<bool>() );
+
+} FC_LOG_AND_RETHROW()
+
+
 BOOST_FIXTURE_TEST_CASE( rex_loans, eosio_system_tester ) try {
 
    const asset   init_balance = core_sym::from_string("40000.0000");
@@ -6283,4 +6694,173 @@ BOOST_AUTO_TEST_CASE( eosio_restrictions_checking ) try {
 } FC_LOG_AND_RETHROW()
 
 
+BOOST_FIXTURE_TEST_CASE( producer_ranking, eosio_system_tester ) try {
+   auto get_ranking = [&]() {
+      const auto data = get_row_by_account( config::system_account_name, config::system_account_name, "prodranking"_n, name(0) );
+      BOOST_REQUIRE( !data.empty() );
+      const auto info = abi_ser.binary_to_variant( "producer_ranking_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      std::vector<std::pair<name, bool>> ranking;
+      for( const auto& p : info["producers"].get_array() ) {
+         ranking.emplace_back( p["owner"].as<name>(), p["is_active"].as_bool() );
+      }
+      return ranking;
+   };
+
+   std::vector<name> producers;
+   for( uint32_t i = 0; i < 52; ++i ) {
+      producers.emplace_back( "rankprod" + std::string(1, 'a' + i / 26) + std::string(1, 'a' + i % 26) );
+   }
+   create_accounts_with_resources( producers );
+   for( const auto& p : producers ) {
+      BOOST_REQUIRE_EQUAL( success(), regproducer( p ) );
+   }
+
+   // without votes, active producers are ranked by name
+   auto ranking = get_ranking();
+   BOOST_REQUIRE_EQUAL( 50, ranking.size() );
+   BOOST_REQUIRE( ranking.front() == std::make_pair( producers[0], true ) );
+   BOOST_REQUIRE( ranking.back() == std::make_pair( producers[49], true ) );
+
+   // a producer receiving votes moves to the top
+   transfer( "eosio", "alice1111111", core_sym::from_string("1000.0000"), "eosio" );
+   BOOST_REQUIRE_EQUAL( success(), stake( "alice1111111", core_sym::from_string("100.0000"), core_sym::from_string("100.0000") ) );
+   BOOST_REQUIRE_EQUAL( success(), vote( "alice1111111"_n, { producers[51] } ) );
+   ranking = get_ranking();
+   BOOST_REQUIRE_EQUAL( 50, ranking.size() );
+   BOOST_REQUIRE( ranking.front() == std::make_pair( producers[51], true ) );
+   BOOST_REQUIRE( ranking.back() == std::make_pair( producers[48], true ) );
+
+   // an unregistered producer keeps its rank as long as it has votes
+   BOOST_REQUIRE_EQUAL( success(), push_action( producers[51], "unregprod"_n, mvo()("producer", producers[51]) ) );
+   BOOST_REQUIRE( get_ranking().front() == std::make_pair( producers[51], false ) );
+
+   // once its votes are gone it drops out of the ranking, which is refilled from the producers table
+   BOOST_REQUIRE_EQUAL( success(), vote( "alice1111111"_n, { producers[1] } ) );
+   ranking = get_ranking();
+   BOOST_REQUIRE_EQUAL( 50, ranking.size() );
+   BOOST_REQUIRE( ranking[0] == std::make_pair( producers[1], true ) );
+   BOOST_REQUIRE( ranking[1] == std::make_pair( producers[0], true ) );
+   BOOST_REQUIRE( ranking[2] == std::make_pair( producers[2], true ) );
+   BOOST_REQUIRE( ranking.back() == std::make_pair( producers[49], true ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( unchanged_top_producers, eosio_system_tester ) try {
+   auto get_last_prop = [&]() {
+      const auto data = get_row_by_account( config::system_account_name, config::system_account_name, "lastpropsch"_n, name(0) );
+      BOOST_REQUIRE( !data.empty() );
+      return abi_ser.binary_to_variant( "last_prop_producers_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   };
+   auto visited_producers = [&]( const fc::variant& last_prop ) {
+      const auto& obj = last_prop.get_object();
+      return obj.contains( "visited_producers" ) ? obj["visited_producers"].as<std::vector<name>>() : std::vector<name>();
+   };
+
+   const auto producer_names = active_and_vote_producers();
+   produce_block( fc::seconds(61) );
+   auto last_prop = get_last_prop();
+   BOOST_REQUIRE_EQUAL( 21, visited_producers( last_prop ).size() );
+
+   // re-registering a producer forces the next schedule update to read the producer rows again
+   const name prod = producer_names[2];
+   block_signing_private_keys.emplace( get_public_key( prod, "bs1" ), get_private_key( prod, "bs1" ) );
+   BOOST_REQUIRE_EQUAL( success(), push_action( prod, "regproducer"_n, mvo()
+                                                ("producer",  prod)
+                                                ("producer_key", get_public_key( prod, "bs1" ) )
+                                                ("url", "")
+                                                ("location", 0)
+                        )
+   );
+   BOOST_REQUIRE( visited_producers( get_last_prop() ).empty() );
+   produce_block();
+
+   produce_block( fc::seconds(61) );
+   const auto rebuilt = get_last_prop();
+   BOOST_REQUIRE_EQUAL( 21, visited_producers( rebuilt ).size() );
+   BOOST_REQUIRE( last_prop["schedule_hash"].as_string() != rebuilt["schedule_hash"].as_string() );
+
+   // a schedule proposed while the previous proposal is still waiting to become pending is rejected by the host;
+   // the visited producers are not kept, so later updates build and propose it again
+   const name next = producer_names[3];
+   block_signing_private_keys.emplace( get_public_key( next, "bs1" ), get_private_key( next, "bs1" ) );
+   BOOST_REQUIRE_EQUAL( success(), push_action( next, "regproducer"_n, mvo()
+                                                ("producer",  next)
+                                                ("producer_key", get_public_key( next, "bs1" ) )
+                                                ("url", "")
+                                                ("location", 0)
+                        )
+   );
+   produce_block();
+
+   produce_block( fc::seconds(61) );
+   const auto rejected = get_last_prop();
+   BOOST_REQUIRE( visited_producers( rejected ).empty() );
+   BOOST_REQUIRE_EQUAL( rebuilt["schedule_hash"].as_string(), rejected["schedule_hash"].as_string() );
+
+   // with 21 producers each proposal needs several hundred blocks to become pending and then active
+   produce_blocks(1500);
+   const auto active = control->active_producers().producers;
+   auto itr = std::find_if( active.begin(), active.end(), [&]( const auto& p ) { return p.producer_name == next; } );
+   BOOST_REQUIRE( itr != active.end() );
+   BOOST_REQUIRE_EQUAL( get_public_key( next, "bs1" ), std::get<block_signing_authority_v0>( itr->authority ).keys[0].key );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( active_schedule_without_digest, eosio_system_tester ) try {
+   auto get_last_prop = [&]() {
+      const auto data = get_row_by_account( config::system_account_name, config::system_account_name, "lastpropsch"_n, name(0) );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "last_prop_producers_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   };
+   // Replaces or removes a row of the system contract in the state of both nodes, bypassing the contract to set up
+   // states it does not create by itself
+   auto write_row = [&]( name table, uint64_t primary_key, const std::optional<std::vector<char>>& value ) {
+      control->abort_block();
+      for( auto* node : { control.get(), validating_node.get() } ) {
+         auto& db = node->mutable_db();
+         const auto& t_id = db.get<eosio::chain::table_id_object, eosio::chain::by_code_scope_table>(
+            boost::make_tuple( config::system_account_name, config::system_account_name, table ) );
+         const auto& row = db.get<eosio::chain::key_value_object, eosio::chain::by_scope_primary>( boost::make_tuple( t_id.id, primary_key ) );
+         if( value ) {
+            db.modify( row, [&]( eosio::chain::key_value_object& o ) { o.value.assign( value->data(), value->size() ); } );
+         } else {
+            db.remove( row );
+            db.modify( t_id, []( eosio::chain::table_id_object& t ) { --t.count; } );
+         }
+      }
+   };
+
+   const auto producer_names = active_and_vote_producers();
+   const auto active = control->active_producers();
+   produce_block( fc::seconds(61) );
+
+   // as right after deploying the contract on a chain whose schedule does not change: no digest is stored yet and the
+   // host rejects the schedule because it is already active
+   write_row( "lastpropsch"_n, 0, {} );
+   BOOST_REQUIRE( get_last_prop().is_null() );
+   produce_block( fc::seconds(61) );
+
+   const auto last_prop = get_last_prop();
+   BOOST_REQUIRE( !last_prop.is_null() );
+   BOOST_REQUIRE_EQUAL( fc::sha256::hash( fc::raw::pack( active.producers ) ).str(), last_prop["schedule_hash"].as_string() );
+   BOOST_REQUIRE_EQUAL( 21, last_prop["visited_producers"].as<std::vector<name>>().size() );
+   BOOST_REQUIRE_EQUAL( active.version, control->active_producers().version );
+
+   // with the digest stored, the next update returns before reading any producer row or calling the host: a key
+   // written behind the contract's back is not picked up, where reading the producer would propose it
+   const name prod = producer_names[2];
+   block_signing_private_keys.emplace( get_public_key( prod, "bs1" ), get_private_key( prod, "bs1" ) );
+   {
+      const auto data = get_row_by_account( config::system_account_name, config::system_account_name, "producers"_n, prod );
+      fc::mutable_variant_object info( abi_ser.binary_to_variant( "producer_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) ).get_object() );
+      block_signing_authority_v0 auth;
+      auth.threshold = 1;
+      auth.keys.push_back( {.key = get_public_key( prod, "bs1" ), .weight = 1} );
+      info["producer_key"] = fc::variant( get_public_key( prod, "bs1" ) );
+      if( info.find( "producer_authority" ) != info.end() )
+         info["producer_authority"] = producer_authority{ .producer_name = prod, .authority = auth }.get_abi_variant()["authority"];
+      write_row( "producers"_n, prod.to_uint64_t(),
+                 abi_ser.variant_to_binary( "producer_info", info, abi_serializer::create_yield_function(abi_serializer_max_time) ) );
+   }
+   produce_block( fc::seconds(61) );
+   BOOST_REQUIRE_EQUAL( last_prop["schedule_hash"].as_string(), get_last_prop()["schedule_hash"].as_string() );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()